@@ -0,0 +1,260 @@
+/*
+ * FleetRunner.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <time.h>
+#include "FleetRunner.h"
+#include "utility.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Get seconds elapsed on a monotonic clock
+	static double now ()
+	{
+		struct timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return time.tv_sec + time.tv_nsec * 1e-9;
+	}
+
+	// Load jobs from stream, return failing line or 0
+	const int FleetRunner::loadJobs (std::istream& stream)
+	{
+		// Line index and line string
+		int index = 0;
+		std::string line;
+
+		// Each line is: type statefile [pc] [budget] [engine],
+		// with PC and budget in hexadecimal format
+		while (getline(stream, line))
+		{
+			// Increment line index by 1
+			index++;
+
+			// Skip empty lines and comments
+			std::istringstream sstream(line);
+			Job job;
+			if (!(sstream >> job.type) || job.type[0] == '#')
+			{
+				continue;
+			}
+
+			// If state file is missing, return failure (non-zero)
+			if (!(sstream >> job.filename))
+			{
+				return index;
+			}
+
+			// Get optional entry PC, budget and engine
+			std::string location, budget;
+			sstream >> location >> budget >> job.engine;
+			job.location = -1;
+			job.budget = ~0ULL;
+
+			// If PC or budget is not hexadecimal, return failure (non-zero)
+			std::istringstream locationStream(location), budgetStream(budget);
+			if ((location.length() && (!(locationStream >> std::hex >> job.location)
+						|| !locationStream.eof()))
+					|| (budget.length() && (!(budgetStream >> std::hex >> job.budget)
+						|| !budgetStream.eof())))
+			{
+				return index;
+			}
+
+			// Add job, with case-insensitive type and engine
+			job.type = toUpper(job.type);
+			job.engine = toUpper(job.engine);
+			job.signal = Microcontroller::SUCCESS;
+			job.pc = 0;
+			job.instructions = 0;
+			jobs.push_back(job);
+		}
+
+		// If no error occurs, return success (0)
+		return 0;
+	}
+
+	// Take next job of a worker, stealing if its queue is empty
+	const bool FleetRunner::next (const int& worker, int& job)
+	{
+		// Take most recent job of own queue
+		{
+			std::lock_guard<std::mutex> guard(queues[worker]->lock);
+			if (!queues[worker]->jobs.empty())
+			{
+				job = queues[worker]->jobs.back();
+				queues[worker]->jobs.pop_back();
+				return true;
+			}
+		}
+
+		// Else, steal oldest job of the other queues
+		for (int i = 1; i < (int) queues.size(); i++)
+		{
+			Queue * victim = queues[(worker + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(victim->lock);
+			if (!victim->jobs.empty())
+			{
+				job = victim->jobs.front();
+				victim->jobs.pop_front();
+				return true;
+			}
+		}
+
+		// No job is left anywhere
+		return false;
+	}
+
+	// Run jobs until all queues are empty
+	void FleetRunner::work (const int& worker)
+	{
+		int job;
+		while (next(worker, job))
+		{
+			runJob(jobs[job]);
+		}
+	}
+
+	// Run a single job
+	void FleetRunner::runJob (Job& job) const
+	{
+		// Create microcontroller in the worker thread, so its memory is
+		// allocated and touched there only
+		Microcontroller * microcontroller = factory->createMicrocontroller(job.type);
+		if (!microcontroller)
+		{
+			job.error = "invalid type";
+			return;
+		}
+		microcontroller->initialize();
+
+		// Never present output of jobs, so workers never wait for the terminal
+		microcontroller->setFrameRate(-1);
+
+		// Select engine if requested
+		if (job.engine.length() && !microcontroller->setEngine(
+				Microcontroller::findEngine(job.engine)))
+		{
+			job.error = "invalid engine";
+			delete microcontroller;
+			return;
+		}
+
+		// Load initial state
+		std::ifstream fstream(job.filename.c_str(), std::ifstream::binary);
+		int status;
+		if (!fstream)
+		{
+			job.error = "state file not found";
+		}
+		else if ((status = microcontroller->loadState(fstream)) < 0)
+		{
+			job.error = "invalid snapshot";
+		}
+		else if (status)
+		{
+			std::ostringstream sstream;
+			sstream << "unknown state at line " << status;
+			job.error = sstream.str();
+		}
+		else
+		{
+			// Run and collect results
+			unsigned long long budget = job.budget;
+			job.signal = microcontroller->runWithDeadline(budget, 0, job.location);
+			job.instructions = job.budget - budget;
+			job.pc = microcontroller->getPC();
+			job.status = microcontroller->statusString();
+		}
+
+		delete microcontroller;
+	}
+
+	// Run all jobs, on one thread per core by default
+	void FleetRunner::run (int threads)
+	{
+		// Size pool to the cores
+		if (threads <= 0)
+		{
+			threads = std::max((int) std::thread::hardware_concurrency(), 1);
+		}
+		threads = std::max(std::min(threads, (int) jobs.size()), 1);
+
+		// Deal contiguous ranges of jobs to the worker queues
+		for (int i = 0; i < threads; i++)
+		{
+			queues.push_back(new Queue);
+		}
+		for (int i = 0; i < (int) jobs.size(); i++)
+		{
+			queues[(long long) i * threads / jobs.size()]->jobs.push_back(i);
+		}
+
+		// Start workers, the calling thread being the first of them
+		double start = now();
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; i++)
+		{
+			workers.push_back(std::thread(&FleetRunner::work, this, i));
+		}
+		work(0);
+		for (int i = 0; i < (int) workers.size(); i++)
+		{
+			workers[i].join();
+		}
+		seconds = now() - start;
+
+		// Release queues
+		for (int i = 0; i < threads; i++)
+		{
+			delete queues[i];
+		}
+		queues.clear();
+	}
+
+	// Write results and throughput summary
+	void FleetRunner::report (std::ostream& stream) const
+	{
+		unsigned long long instructions = 0;
+		int failed = 0;
+
+		// Write result of each job in batch order
+		for (int i = 0; i < (int) jobs.size(); i++)
+		{
+			const Job& job = jobs[i];
+			stream << "Job " << std::dec << i + 1 << " (" << job.type
+				   << ' ' << job.filename << "): ";
+
+			// If job could not run, write the reason
+			if (job.error.length())
+			{
+				stream << "error, " << job.error << '\n';
+				failed++;
+				continue;
+			}
+
+			stream << Microcontroller::SIGNALS[job.signal]
+				   << " at PC 0x" << std::hex << std::setw(3) << std::setfill('0')
+				   << job.pc << " after " << std::dec << job.instructions
+				   << " instructions\n" << job.status;
+			instructions += job.instructions;
+		}
+
+		// Write throughput summary
+		stream << std::dec << jobs.size() << " jobs (" << failed << " failed) in "
+			   << seconds << " s: "
+			   << (seconds > 0 ? jobs.size() / seconds : 0) << " jobs/s, "
+			   << (seconds > 0 ? instructions / seconds : 0) << " instructions/s"
+			   << std::endl;
+	}
+}
+
+
@@ -0,0 +1,68 @@
+/*
+ * FleetRunner.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_FLEETRUNNER_H_
+#define SRC_FLEETRUNNER_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <iostream>
+#include "Microcontroller.h"
+#include "MicrocontrollerFactory.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Runs batches of independent microcontroller jobs on a work-stealing thread pool
+	class FleetRunner
+	{
+	private:
+		// Job of a batch and its result
+		struct Job
+		{
+			std::string type, filename, engine;	// Microcontroller type, initial state file and execution engine
+			int location;	// Entry PC, or -1 to start from the saved PC
+			unsigned long long budget;	// Maximum number of instructions to execute
+			int signal;	// Final signal
+			int pc;	// Final PC
+			std::string status;	// Final PC and registers
+			unsigned long long instructions;	// Number of instructions executed
+			std::string error;	// Reason the job could not run
+		};
+
+		// Job queue of a worker, other workers steal from its front
+		struct Queue
+		{
+			std::deque<int> jobs;	// Indexes of waiting jobs
+			std::mutex lock;	// Queue lock
+		};
+
+		const MicrocontrollerFactory * factory;	// Microcontroller producer
+		std::vector<Job> jobs;	// Jobs of the batch
+		std::vector<Queue *> queues;	// Job queue of each worker
+		double seconds;	// Wall time of the last run
+
+	public:
+		FleetRunner(const MicrocontrollerFactory * factoryInput) :
+				factory(factoryInput), seconds(0) {}	// Constructor with factory
+
+	private:
+		const bool next(const int& worker, int& job);	// Take next job of a worker, stealing if its queue is empty
+		void work(const int& worker);	// Run jobs until all queues are empty
+		void runJob(Job& job) const;	// Run a single job
+
+	public:
+		const int loadJobs(std::istream& stream);	// Load jobs from stream, return failing line or 0
+		void run(int threads = 0);	// Run all jobs, on one thread per core by default
+		void report(std::ostream& stream) const;	// Write results and throughput summary
+	};
+}
+
+
+
+#endif /* SRC_FLEETRUNNER_H_ */
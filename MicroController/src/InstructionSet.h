@@ -0,0 +1,96 @@
+/*
+ * InstructionSet.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_INSTRUCTIONSET_H_
+#define SRC_INSTRUCTIONSET_H_
+
+#include "Microcontroller.h"
+
+/* DECLARATIVE INSTRUCTION SETS:
+   - A plug-in describes its instruction set by specializing
+     InstructionSet<Plugin> (declared friend of the plug-in) with:
+       static constexpr Instruction<Plugin> LIST[] = {
+           {opcode, {mnemonic, operands, length, reads, writes, branch}, &Plugin::handler},
+           ...};
+       static constexpr const char * REGISTERS[] = {name, ..., NULL};
+       static constexpr DecodeTable<Plugin> TABLE = buildDecodeTable(LIST);
+   - The handler executes the instruction at pc, next being preset to pc +
+     length for branches to overwrite, and returns SUCCESS to move PC to
+     next or a signal to stop.
+   - REGISTERS names the bytes saved by getRegisters(), in order, for the
+     status and text state.
+   - TABLE is built at compile time: a listed opcode twice, or an
+     instruction longer than 4 bytes, does not compile. The core generates
+     the interpreter, the threaded engine and the disassembler from it.
+*/
+
+namespace MicrocontrollerEmulation
+{
+	// Instruction set of a plug-in, specialized by every plug-in
+	template <class Chip>
+	struct InstructionSet;
+
+	// Declarative description of one instruction: encoding, description and semantics
+	template <class Chip>
+	struct Instruction
+	{
+		unsigned char opcode;	// Opcode, operands follow as described
+		Microcontroller::InstructionInfo info;	// Mnemonic, operands, length, memory accesses and branch flag
+		const int (Chip::*execute)(const int& pc, int& next);	// Handler
+	};
+
+	// Decode table indexed by opcode, built at compile time
+	template <class Chip>
+	struct DecodeTable
+	{
+		bool valid[256];	// Whether the opcode is listed
+		Microcontroller::InstructionInfo info[256];	// Description of listed opcodes
+		const int (Chip::*execute[256])(const int& pc, int& next);	// Handler of listed opcodes
+	};
+
+	// Build the decode table of an instruction list
+	template <class Chip, int N>
+	constexpr DecodeTable<Chip> buildDecodeTable(const Instruction<Chip> (&list)[N])
+	{
+		DecodeTable<Chip> table = {};
+		for (int i = 0; i < N; i++)
+		{
+			const Instruction<Chip>& instruction = list[i];
+
+			// Reject ambiguous or overlong instructions at compile time
+			if (table.valid[instruction.opcode])
+			{
+				throw "opcode listed twice";
+			}
+			if (instruction.info.length < 1 || instruction.info.length > 4)
+			{
+				throw "instruction length out of range";
+			}
+
+			table.valid[instruction.opcode] = true;
+			table.info[instruction.opcode] = instruction.info;
+			table.execute[instruction.opcode] = instruction.execute;
+		}
+		return table;
+	}
+}
+
+// Expand a macro once for every opcode, given as a hexadecimal literal
+#define INSTRUCTION_SET_OPCODES16(M, H) \
+	M(0x##H##0) M(0x##H##1) M(0x##H##2) M(0x##H##3) M(0x##H##4) M(0x##H##5) M(0x##H##6) M(0x##H##7) \
+	M(0x##H##8) M(0x##H##9) M(0x##H##A) M(0x##H##B) M(0x##H##C) M(0x##H##D) M(0x##H##E) M(0x##H##F)
+#define INSTRUCTION_SET_OPCODES(M) \
+	INSTRUCTION_SET_OPCODES16(M, 0) INSTRUCTION_SET_OPCODES16(M, 1) INSTRUCTION_SET_OPCODES16(M, 2) \
+	INSTRUCTION_SET_OPCODES16(M, 3) INSTRUCTION_SET_OPCODES16(M, 4) INSTRUCTION_SET_OPCODES16(M, 5) \
+	INSTRUCTION_SET_OPCODES16(M, 6) INSTRUCTION_SET_OPCODES16(M, 7) INSTRUCTION_SET_OPCODES16(M, 8) \
+	INSTRUCTION_SET_OPCODES16(M, 9) INSTRUCTION_SET_OPCODES16(M, A) INSTRUCTION_SET_OPCODES16(M, B) \
+	INSTRUCTION_SET_OPCODES16(M, C) INSTRUCTION_SET_OPCODES16(M, D) INSTRUCTION_SET_OPCODES16(M, E) \
+	INSTRUCTION_SET_OPCODES16(M, F)
+
+
+
+#endif /* SRC_INSTRUCTIONSET_H_ */
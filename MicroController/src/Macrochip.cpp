@@ -6,329 +6,271 @@
  */
 
 #include <iostream>
-#include <iomanip>
 #include <algorithm>
 #include <string>
-#include <sstream>
+#include <thread>
+#include <chrono>
 #include "Macrochip.h"
+#include "MicrocontrollerFactory.h"
 
 namespace MicrocontrollerEmulation
 {
-	// Initialize initial PC, memory size and W register value
-	const int Macrochip::PC = 0, Macrochip::MEM_SIZE = 1536,
-		  Macrochip::VIDEO_MEM_SIZE = 1000, Macrochip::VIDEO_WIDTH = 40,
-		  Macrochip::VIDEO_HEIGHT = 25;
+	// Register type PIC32F42
+	static const MicrocontrollerFactory::Registration<Macrochip> REGISTRATION("PIC32F42");
+
+	// Initialize initial PC, video memory size and W register value
+	const int Macrochip::PC = 0, Macrochip::VIDEO_MEM_SIZE = 1000,
+		  Macrochip::VIDEO_WIDTH = 40, Macrochip::VIDEO_HEIGHT = 25;
 	const unsigned char Macrochip::W = 0;
 
+	// Initialize instructions executed between chances to publish a frame
+	const unsigned long long Macrochip::FRAME_SLICE = 1 << 16;
+
 	// Display content of video memory
-	void Macrochip::displayScreen () const
+	void Macrochip::displayScreen (const unsigned char * video) const
 	{
-		std::cout << "Output Screen:\n"
-				  << std::setw(44) << std::setfill('-') << '-' << std::endl;
-		for (int i = 0; i < 25; i++)
+		// Build the whole frame first, so it is written and flushed once
+		std::string border(VIDEO_WIDTH + 4, '-');
+		std::string frame = "Output Screen:\n" + border + '\n';
+		frame.reserve(frame.size() + VIDEO_HEIGHT * (VIDEO_WIDTH + 5) + border.size() + 1);
+		for (int i = 0; i < VIDEO_HEIGHT; i++)
 		{
-			std::cout << "| ";
-			for (int j = 0; j < 40; j++)
+			frame += "| ";
+			for (int j = 0; j < VIDEO_WIDTH; j++)
 			{
-				// Get current character
-				unsigned char character = look(i * 40 + j);
-
-				// Display it
-				if (character >= 0x20)
-				{
-					std::cout << std::setw(1) << std::setfill(' ')
-							  << character;
-				}
-				else
-				{
-					std::cout << ' ';
-				}
+				// Get current character, control characters show as spaces
+				unsigned char character = video[i * VIDEO_WIDTH + j];
+				frame += character >= 0x20 ? (char) character : ' ';
 			}
-			std::cout << " |" << std::endl;
+			frame += " |\n";
 		}
-		std::cout << std::setw(44) << std::setfill('-') << '-' << std::endl;
+		frame += border + '\n';
+
+		std::cout.write(frame.data(), frame.size());
+		std::cout.flush();
 	}
 
-	// Reset microcontroller to initial state
-	void Macrochip::initialize ()
+	// Display frames published by the CPU, asking for one every frame
+	// period until the frame rate changes, so frame timing runs across
+	// engine calls
+	void Macrochip::presentFrames ()
 	{
-		// Reset PC and register W to initial value
-		setPC(PC);
-		registerW = W;
+		std::chrono::steady_clock::duration period =
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double>(1 / frameRate));
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + period;
+		std::unique_lock<std::mutex> guard(frameLock);
 
-		// If memory is not allocated, do allocation
-		if (!getMemory())
-		{
-			setMemory(new unsigned char[MEM_SIZE]());
-		}
-		else
+		while (presenting)
 		{
-			// Else, re-initialize memory to 0
-			std::fill_n(getMemory(), MEM_SIZE, 0);
+			// Wait for a published frame, the end of the frame period or a stop
+			frameSignal.wait_until(guard, deadline, [this] { return !presenting || frameReady; });
+
+			// Display published frame, holding the lock so execution does
+			// not return while the terminal is written
+			if (frameReady)
+			{
+				frameReady = false;
+				displayScreen(&frame[0]);
+			}
+
+			// Ask for a frame once per period, skipping periods missed
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= deadline)
+			{
+				frameWanted.store(true, std::memory_order_relaxed);
+				deadline = std::max(deadline + period, now);
+			}
 		}
 	}
 
-	// Execute from current PC or from a specific location
-	const int Macrochip::execute (const int& location)
+	// Publish video memory if a frame is wanted and the screen changed,
+	// called by the CPU between slices of execution, never waiting for
+	// the terminal
+	void Macrochip::publishFrame ()
 	{
-		// If location is provided, set pc to that
-		if (location != -1)
+		if (!frameWanted.load(std::memory_order_relaxed) || !videoDirty.load(std::memory_order_relaxed))
 		{
-			setPC(location);
+			return;
 		}
 
-		// Execute program until halt opcode found
-		while (look(getPC()) != 0xFF)
+		// If a frame is being displayed, try again after the next slice
+		std::unique_lock<std::mutex> guard(frameLock, std::try_to_lock);
+		if (!guard.owns_lock())
 		{
-			// Get current PC and opcode
-			int pc = getPC();
-			unsigned char opcode = look(getPC());
-
-			// If PC go outside memory, return SIGWEED opcode
-			if (pc >= MEM_SIZE)
-			{
-				return Microcontroller::SIGWEED;
-			}
+			return;
+		}
 
-			// Temporary value and memory address
-			int address;
-			unsigned char value;
+		std::copy(getMemory(), getMemory() + VIDEO_MEM_SIZE, frame.begin());
+		videoDirty.store(false, std::memory_order_relaxed);
+		frameWanted.store(false, std::memory_order_relaxed);
+		frameReady = true;
+		guard.unlock();
+		frameSignal.notify_one();
+	}
 
-			// Fetch, Decode and Execute instruction
-			switch (opcode)
+	// Set rate of frames presented while executing, restarting the frame
+	// presenter
+	void Macrochip::setFrameRate (const double& rate)
+	{
+		// Stop presenter of the previous rate
+		if (presenter.joinable())
+		{
 			{
-				case 0x50:
-					// Move value to W
-
-					// Set W to specified value
-					registerW = look(pc + 1);
-
-					// Update PC
-					setPC(pc + 2);
-					break;
-				case 0x51:
-					// Move W to memory
-
-					// Get target memory location
-					address = ((int) look(pc + 1) << 8) | look(pc + 2);
-
-					// Modify memory content
-					modify(address, registerW);
-
-					// Update PC
-					setPC(pc + 3);
-					break;
-				case 0x5A:
-					// Add value to W
-
-					// Get and add value to W
-					registerW += look(pc + 1);
-
-					// Update PC
-					setPC(pc + 2);
-					break;
-				case 0x5B:
-					// Subtract value from W
-
-					// Get and subtract value from W
-					registerW -= look(pc + 1);
-
-					// Update PC
-					setPC(pc + 2);
-					break;
-				case 0x6E:
-					// Go to address
-
-					// Get target memory location
-					address = ((int) look(pc + 1) << 8) | look(pc + 2);
-
-					// Update PC
-					setPC(address);
-					break;
-				case 0x70:
-					// Brach if not equal
-
-					// Get comparison value
-					value = look(pc + 1);
-
-					// Get target memory location
-					address = ((int) look(pc + 2) << 8) | look(pc + 3);
-
-					// If comparison value is the same as W, branch
-					if (value == registerW)
-					{
-						setPC(address);
-					}
-					else
-					{
-						// Else, ignore
-						setPC(pc + 4);
-					}
-				default:
-					// If invalid opcode found, return SIGOP signal
-					return Microcontroller::SIGOP;
-					break;
+				std::lock_guard<std::mutex> guard(frameLock);
+				presenting = false;
 			}
+			frameSignal.notify_one();
+			presenter.join();
 		}
 
-		// If halt opcode catch, return HALT signal
-		return Microcontroller::HALT;
+		// Start presenter living until the rate changes
+		frameRate = rate;
+		if (frameRate > 0)
+		{
+			frame.resize(VIDEO_MEM_SIZE);
+			presenting = true;
+			frameReady = false;
+			frameWanted.store(false, std::memory_order_relaxed);
+			presenter = std::thread(&Macrochip::presentFrames, this);
+		}
 	}
 
-	// Look at a specific memory location
-	const unsigned char Macrochip::look (const int& location) const
+	// Display screen if video memory was written
+	void Macrochip::present ()
 	{
-		// If location input is outside memory, return 0
-		if (location < 0 || location >= MEM_SIZE)
+		if (frameRate >= 0 && videoDirty.exchange(false, std::memory_order_relaxed))
 		{
-			return 0;
+			displayScreen(getMemory());
 		}
-
-		// Else, return memory content
-		return getMemory()[location];
 	}
 
-	// Modify a specific memory location
-	void Macrochip::modify (const int& location, const unsigned char& value)
+	// Reset microcontroller to initial state
+	void Macrochip::initialize ()
 	{
-		// If location input is valid, modify memory content
-		if (location >= 0 && location < MEM_SIZE)
-		{
-			getMemory()[location] = value;
+		// Reset PC and register W to initial value
+		setPC(PC);
+		registerW = W;
 
-			// If data is written on video memory, display screen
-			if (location < VIDEO_MEM_SIZE)
-			{
-				displayScreen();
-			}
-		}
+		// Allocate memory or re-initialize it to 0
+		initializeMemory();
 	}
 
-	// Return PC and registers
-	const std::string Macrochip::statusString () const
+	// Save register W to a snapshot buffer
+	const int Macrochip::getRegisters (unsigned char * registers) const
 	{
-		// Create output string stream
-		std::ostringstream stream;
-
-		// Add status to string stream
-		stream << "Status:\n"
-			   << " - PC: 0x"
-			   << std::hex << std::setw(3) << std::setfill('0')
-			   << getPC() << '\n'
-			   << " - Register W: 0x"
-			   << std::hex << std::setw(2) << std::setfill('0')
-			   << (int) registerW << std::endl;
-
-		// Return status string
-		return stream.str();
+		registers[0] = registerW;
+		return 1;
 	}
 
-	// Get current state
-	const std::string Macrochip::getState () const
+	// Restore register W from a snapshot buffer
+	void Macrochip::setRegisters (const unsigned char * registers)
 	{
-		// Create output string stream
-		std::ostringstream sstream;
-
-		// Add PC and register(s) to output
-		sstream << "PC=" << getPC()
-				<< "\nW=" << (int) registerW
-				<< std::endl;
+		registerW = registers[0];
+	}
 
-		// Loop through memory to save non-zero values
-		for (int i = 0; i < MEM_SIZE; i++)
-		{
-			// Get current value
-			unsigned char value = look(i);
+	// Mark screen dirty after memory is replaced
+	void Macrochip::memoryLoaded ()
+	{
+		videoDirty.store(true, std::memory_order_relaxed);
+	}
 
-			// If value is non-zero, save to output
-			if (value)
-			{
-				sstream << i << '=' << (int) value << std::endl;
-			}
-		}
+	// Move value to W
+	const int Macrochip::moveValueToW (const int& pc, int& next)
+	{
+		registerW = fetch(pc + 1);
+		return Microcontroller::SUCCESS;
+	}
 
-		// Return state string
-		return sstream.str();
+	// Move W to memory
+	const int Macrochip::moveWToMemory (const int& pc, int& next)
+	{
+		write(fetchAddress(pc + 1), registerW);
+		return Microcontroller::SUCCESS;
 	}
 
-	// Set state from stream
-	const int Macrochip::setState (std::istream& stream)
+	// Add value to W
+	const int Macrochip::addValueToW (const int& pc, int& next)
 	{
-		// Line index
-		int index = 0;
+		registerW += fetch(pc + 1);
+		return Microcontroller::SUCCESS;
+	}
 
-		// Line string
-		std::string line;
+	// Subtract value from W
+	const int Macrochip::subtractValueFromW (const int& pc, int& next)
+	{
+		registerW -= fetch(pc + 1);
+		return Microcontroller::SUCCESS;
+	}
 
-		// Temporary location and value
-		int location, value;
+	// Go to address
+	const int Macrochip::jump (const int& pc, int& next)
+	{
+		next = fetchAddress(pc + 1);
+		return Microcontroller::SUCCESS;
+	}
 
-		// Fetch each line until EOF reached
-		while (getline(stream, line))
+	// Go to address if value equals W, else skip to the next instruction
+	const int Macrochip::branchIfEqual (const int& pc, int& next)
+	{
+		if (fetch(pc + 1) == registerW)
 		{
-			// Increment line index by 1
-			index++;
+			next = fetchAddress(pc + 2);
+		}
+		return Microcontroller::SUCCESS;
+	}
 
-			// Create input stream
-			std::istringstream sstream(line);
+	// Raise HALT
+	const int Macrochip::halt (const int& pc, int& next)
+	{
+		return Microcontroller::HALT;
+	}
 
-			// Modify PC state
-			if (line.find("PC") != std::string::npos)
-			{
-				// Ignore 'PC='
-				sstream.ignore(3);
+	// Mark screen dirty after a write on video memory
+	inline void Macrochip::written (const int& location)
+	{
+		if (location < VIDEO_MEM_SIZE)
+		{
+			videoDirty.store(true, std::memory_order_relaxed);
+		}
+	}
 
-				// If location cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> location))
-				{
-					return index;
-				}
+	// Execute from current PC with the selected engine
+	template <bool BOUNDED>
+	const int Macrochip::runEngine (unsigned long long& budget)
+	{
+		// Without frame presenter, run the selected engine straight
+		if (frameRate <= 0)
+		{
+			return MicrocontrollerCore<Macrochip, 1536>::runEngine<BOUNDED>(budget);
+		}
 
-				// Modify PC
-				setPC(location);
-			}
-			else if (line.find("W") != std::string::npos)
+		// Else, run it in slices and publish a frame after each one if the
+		// presenter asked for it, so the CPU loop never waits for the terminal
+		int signal;
+		do
+		{
+			unsigned long long slice = BOUNDED ? std::min(FRAME_SLICE, budget) : FRAME_SLICE;
+			unsigned long long left = slice;
+			signal = MicrocontrollerCore<Macrochip, 1536>::runEngine<true>(left);
+			if (BOUNDED)
 			{
-				// Modify register W state
-
-				// Ignore 'W='
-				sstream.ignore(2);
-
-				// If value cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> value))
-				{
-					return index;
-				}
-
-				// Modify register W
-				registerW = value;
+				budget -= slice - left;
 			}
-			else
-			{
-				// Else, modify memory content
-
-				// If location cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> location))
-				{
-					return index;
-				}
-
-				// Ignore '='
-				sstream.ignore(1);
-
-				// If value cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> value))
-				{
-					return index;
-				}
+			publishFrame();
+		}
+		while (signal == Microcontroller::BUDGET_EXHAUSTED && (!BOUNDED || budget));
 
-				// Modify memory content
-				modify(location, value);
-			}
+		// Wait for the frame being displayed, and leave a frame published
+		// too late to present()
+		std::lock_guard<std::mutex> guard(frameLock);
+		if (frameReady)
+		{
+			frameReady = false;
+			videoDirty.store(true, std::memory_order_relaxed);
 		}
 
-		// If no error occurs, return success (0)
-		return 0;
+		return signal;
 	}
 }
 
@@ -10,32 +10,80 @@
 
 #include <string>
 #include <iostream>
-#include "Microcontroller.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include "MicrocontrollerCore.h"
 
 namespace MicrocontrollerEmulation
 {
-	class Macrochip : public Microcontroller
+	class Macrochip : public MicrocontrollerCore<Macrochip, 1536>
 	{
+		friend class MicrocontrollerCore<Macrochip, 1536>;
+		friend struct InstructionSet<Macrochip>;
+
 	private:
-		static const int PC, MEM_SIZE, VIDEO_MEM_SIZE, VIDEO_WIDTH, VIDEO_HEIGHT;	// Initial PC, memory size, video memory size, video width and video height
+		static const int PC, VIDEO_MEM_SIZE, VIDEO_WIDTH, VIDEO_HEIGHT;	// Initial PC, video memory size, video width and video height
 		static const unsigned char W;	// Initial value of register W
 		unsigned char registerW;	// Special purpose register W
+		static const unsigned long long FRAME_SLICE;	// Instructions executed between chances to publish a frame
+		double frameRate;	// Frames presented per second while executing, 0 for none, negative for headless
+		std::atomic<bool> videoDirty;	// Whether video memory was written since last presented
+		std::atomic<bool> frameWanted;	// Whether the frame presenter asks the CPU for a frame
+		bool presenting;	// Whether the frame presenter should keep running
+		bool frameReady;	// Whether a frame was published and not displayed yet
+		std::vector<unsigned char> frame;	// Copy of video memory published by the CPU
+		std::mutex frameLock;	// Lock of presenting flag and published frame
+		std::condition_variable frameSignal;	// Wakes frame presenter up when a frame is published or it must stop
+		std::thread presenter;	// Frame presenter, running while frame rate is positive
 
 	public:
-		Macrochip(const std::string& type) : Microcontroller(type) {}	// Constructor with type
+		Macrochip(const std::string& type) : MicrocontrollerCore<Macrochip, 1536>(type),
+				frameRate(0), videoDirty(false), frameWanted(false), presenting(false),
+				frameReady(false) {}	// Constructor with type
+		~Macrochip() { setFrameRate(0); }	// Destructor, stopping the frame presenter
 
 	private:
-		void displayScreen() const;	// Display content of video memory
+		void displayScreen(const unsigned char * video) const;	// Display content of video memory
+		void presentFrames();	// Display frames published by the CPU, asking for one every frame period
+		void publishFrame();	// Publish video memory if a frame is wanted and the screen changed
+		const int moveValueToW(const int& pc, int& next);	// Move value to W
+		const int moveWToMemory(const int& pc, int& next);	// Move W to memory
+		const int addValueToW(const int& pc, int& next);	// Add value to W
+		const int subtractValueFromW(const int& pc, int& next);	// Subtract value from W
+		const int jump(const int& pc, int& next);	// Go to address
+		const int branchIfEqual(const int& pc, int& next);	// Go to address if value equals W
+		const int halt(const int& pc, int& next);	// Raise HALT
+		void written(const int& location);	// Display screen after a write on video memory
+		template <bool BOUNDED> const int runEngine(unsigned long long& budget);	// Execute from current PC with the selected engine
+		const int getRegisters(unsigned char * registers) const;	// Save register W to a snapshot buffer
+		void setRegisters(const unsigned char * registers);	// Restore register W from a snapshot buffer
+		void memoryLoaded();	// Mark screen dirty after memory is replaced
 
 	public:
-		const int getMemorySize() const { return MEM_SIZE; }	// Get size of memory
+		void setFrameRate(const double& rate);	// Set rate of frames presented while executing
+		void present();	// Display screen if video memory was written
 		void initialize();	// Reset microcontroller to initial state
-		const int execute(const int& location = -1);	// Execute from current PC or from a specific location
-		const unsigned char look(const int& location) const;	// Look at a specific memory location
-		void modify(const int& location, const unsigned char& value);	// Modify a specific memory location
-		const std::string statusString() const;	// Return PC and registers
-		const std::string getState() const;	// Get current state
-		const int setState(std::istream& stream);	// Set state from stream
+	};
+
+	// Instruction set of Macrochip: opcode, mnemonic, operands, length,
+	// memory reads, memory writes, branch and handler
+	template <>
+	struct InstructionSet<Macrochip>
+	{
+		static constexpr Instruction<Macrochip> LIST[] = {
+			{0x50, {"MOVLW", "b", 2, 0, 0, false}, &Macrochip::moveValueToW},
+			{0x51, {"MOVWF", "a", 3, 0, 1, false}, &Macrochip::moveWToMemory},
+			{0x5A, {"ADDLW", "b", 2, 0, 0, false}, &Macrochip::addValueToW},
+			{0x5B, {"SUBLW", "b", 2, 0, 0, false}, &Macrochip::subtractValueFromW},
+			{0x6E, {"GOTO", "t", 3, 0, 0, false}, &Macrochip::jump},
+			{0x70, {"BEQ", "bt", 4, 0, 0, true}, &Macrochip::branchIfEqual},
+			{0xFF, {"HALT", "", 1, 0, 0, false}, &Macrochip::halt}
+		};
+		static constexpr const char * REGISTERS[] = {"W", NULL};	// Register W
+		static constexpr DecodeTable<Macrochip> TABLE = buildDecodeTable(LIST);
 	};
 }
 
@@ -0,0 +1,172 @@
+/*
+ * MemoryScanner.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include "MemoryScanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace MicrocontrollerEmulation
+{
+	// Kinds of scan: a masked byte value in one buffer, or the first
+	// difference or equality between two buffers
+	enum {
+		SCAN_BYTE, SCAN_DIFFERENCE, SCAN_EQUALITY
+	};
+
+	// Check if the scanned condition holds at an offset
+	template <int KIND>
+	static inline const bool matches (const unsigned char * first,
+			const unsigned char * second, const int& i,
+			const unsigned char& value, const unsigned char& mask)
+	{
+		switch (KIND)
+		{
+			case SCAN_BYTE:
+				return (first[i] & mask) == value;
+			case SCAN_DIFFERENCE:
+				return first[i] != second[i];
+			default:
+				return first[i] == second[i];
+		}
+	}
+
+	// Scan byte by byte from an offset
+	template <int KIND>
+	static const int scanScalar (const unsigned char * first,
+			const unsigned char * second, const int& length,
+			const unsigned char& value, const unsigned char& mask, int i = 0)
+	{
+		for (; i < length; i++)
+		{
+			if (matches<KIND>(first, second, i, value, mask))
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+#if defined(__SSE2__)
+	// Scan 16 bytes at a time: each block compares to a bit mask of bytes
+	// equal to the value (or in the other buffer), the first set bit of
+	// which is the result
+	template <int KIND>
+	static const int scanSSE2 (const unsigned char * first,
+			const unsigned char * second, const int& length,
+			const unsigned char& value, const unsigned char& mask)
+	{
+		const __m128i values = _mm_set1_epi8(value);
+		const __m128i masks = _mm_set1_epi8(mask);
+		int i = 0;
+		for (; i + 16 <= length; i += 16)
+		{
+			__m128i block = _mm_loadu_si128((const __m128i *) (first + i));
+			__m128i equal = KIND == SCAN_BYTE
+					? _mm_cmpeq_epi8(_mm_and_si128(block, masks), values)
+					: _mm_cmpeq_epi8(block, _mm_loadu_si128((const __m128i *) (second + i)));
+			unsigned int bits = _mm_movemask_epi8(equal);
+			if (KIND == SCAN_DIFFERENCE)
+			{
+				bits ^= 0xFFFF;
+			}
+			if (bits)
+			{
+				return i + __builtin_ctz(bits);
+			}
+		}
+		return scanScalar<KIND>(first, second, length, value, mask, i);
+	}
+
+	// Scan 32 bytes at a time, as scanSSE2
+	template <int KIND>
+	__attribute__((target("avx2")))
+	static const int scanAVX2 (const unsigned char * first,
+			const unsigned char * second, const int& length,
+			const unsigned char& value, const unsigned char& mask)
+	{
+		const __m256i values = _mm256_set1_epi8(value);
+		const __m256i masks = _mm256_set1_epi8(mask);
+		int i = 0;
+		for (; i + 32 <= length; i += 32)
+		{
+			__m256i block = _mm256_loadu_si256((const __m256i *) (first + i));
+			__m256i equal = KIND == SCAN_BYTE
+					? _mm256_cmpeq_epi8(_mm256_and_si256(block, masks), values)
+					: _mm256_cmpeq_epi8(block, _mm256_loadu_si256((const __m256i *) (second + i)));
+			unsigned int bits = _mm256_movemask_epi8(equal);
+			if (KIND == SCAN_DIFFERENCE)
+			{
+				bits = ~bits;
+			}
+			if (bits)
+			{
+				return i + __builtin_ctz(bits);
+			}
+		}
+		return scanScalar<KIND>(first, second, length, value, mask, i);
+	}
+
+	// Check once if the host supports AVX2
+	static const bool hasAVX2 ()
+	{
+		static const bool supported = __builtin_cpu_supports("avx2");
+		return supported;
+	}
+#endif
+
+	// Scan with the widest instruction set available
+	template <int KIND>
+	static const int scan (const unsigned char * first,
+			const unsigned char * second, const int& length,
+			const unsigned char& value = 0, const unsigned char& mask = 0)
+	{
+#if defined(__SSE2__)
+		if (hasAVX2())
+		{
+			return scanAVX2<KIND>(first, second, length, value, mask);
+		}
+		return scanSSE2<KIND>(first, second, length, value, mask);
+#else
+		return scanScalar<KIND>(first, second, length, value, mask);
+#endif
+	}
+
+	// Return offset of the first byte whose bits under mask equal value, -1 if none
+	const int MemoryScanner::findByte (const unsigned char * data, const int& length,
+			const unsigned char& value, const unsigned char& mask)
+	{
+		return scan<SCAN_BYTE>(data, data, length, value & mask, mask);
+	}
+
+	// Return offset of the first byte differing between two buffers, -1 if none
+	const int MemoryScanner::findDifference (const unsigned char * first,
+			const unsigned char * second, const int& length)
+	{
+		return scan<SCAN_DIFFERENCE>(first, second, length);
+	}
+
+	// Return offset of the first byte equal in two buffers, -1 if none
+	const int MemoryScanner::findEquality (const unsigned char * first,
+			const unsigned char * second, const int& length)
+	{
+		return scan<SCAN_EQUALITY>(first, second, length);
+	}
+
+	// Get name of the instruction set used by scans
+	const char * MemoryScanner::getInstructionSet ()
+	{
+#if defined(__SSE2__)
+		return hasAVX2() ? "AVX2" : "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+}
+
+
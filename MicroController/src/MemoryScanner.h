@@ -0,0 +1,33 @@
+/*
+ * MemoryScanner.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_MEMORYSCANNER_H_
+#define SRC_MEMORYSCANNER_H_
+
+namespace MicrocontrollerEmulation
+{
+	// Vectorized scans of memory buffers. AVX2 is used if the host supports
+	// it, SSE2 otherwise on x86, and a scalar loop on other hosts
+	class MemoryScanner
+	{
+	public:
+		// Return offset of the first byte whose bits under mask equal value,
+		// -1 if none
+		static const int findByte(const unsigned char * data, const int& length,
+				const unsigned char& value, const unsigned char& mask = 0xFF);
+		// Return offset of the first byte differing between two buffers, -1 if none
+		static const int findDifference(const unsigned char * first,
+				const unsigned char * second, const int& length);
+		// Return offset of the first byte equal in two buffers, -1 if none
+		static const int findEquality(const unsigned char * first,
+				const unsigned char * second, const int& length);
+		// Get name of the instruction set used by scans
+		static const char * getInstructionSet();
+	};
+}
+
+#endif /* SRC_MEMORYSCANNER_H_ */
@@ -5,14 +5,1349 @@
  *      Author: huy
  */
 
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <unordered_map>
+#include <new>
+#include <time.h>
+#include <sys/mman.h>
 #include "Microcontroller.h"
+#include "MemoryScanner.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "Timeline.h"
 
 namespace MicrocontrollerEmulation
 {
+	// Names of execution signals, in the same order as the signal enum
+	const std::string Microcontroller::SIGNALS[] = {"SUCCESS", "SIGWEED", "SIGOP",
+		"HALT", "BUDGET_EXHAUSTED", "BREAK"};
+
+	// Names of execution engines, in the same order as the engine enum
+	const std::string Microcontroller::ENGINES[] = {"INTERPRETER", "THREADED", "JIT"};
+
+	// Leading bytes and version of binary snapshots
+	const char Microcontroller::SNAPSHOT_MAGIC[4] = {'M', 'C', 'E', 'S'};
+	const unsigned short Microcontroller::SNAPSHOT_VERSION = 3;
+
+	// Instructions executed between two deadline checks
+	static const unsigned long long DEADLINE_SLICE = 1 << 16;
+
+	// Page of zeros, compared against to skip pages holding only 0
+	static const unsigned char ZERO_PAGE[1 << Microcontroller::PAGE_SHIFT] = {};
+
+	// Check if at most a page of bytes are all 0
+	static bool isZero (const unsigned char * bytes, const int& length)
+	{
+		return MemoryScanner::findDifference(bytes, ZERO_PAGE, length) < 0;
+	}
+
+	// Get seconds elapsed on a monotonic clock
+	static double now ()
+	{
+		struct timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return time.tv_sec + time.tv_nsec * 1e-9;
+	}
+
 	// Destructor
 	Microcontroller::~Microcontroller () {
+		// Stop profiler before memory goes away
+		delete profiler;
+		delete tracer;
+		delete timeline;
+
 		// Delete memory array
-		delete[] memory;
+		releaseMemory();
+	}
+
+	// Allocate zeroed memory, releasing any previous one. Large memories are
+	// mapped, so pages never written are never committed
+	void Microcontroller::allocateMemory (const size_t& bytes)
+	{
+		releaseMemory();
+
+		if (bytes < (size_t) MAPPED_MEMORY_SIZE)
+		{
+			memory = new unsigned char[bytes]();
+		}
+		else
+		{
+			void * pointer = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (pointer == MAP_FAILED)
+			{
+				throw std::bad_alloc();
+			}
+			memory = (unsigned char *) pointer;
+		}
+		memoryBytes = bytes;
+	}
+
+	// Release memory
+	void Microcontroller::releaseMemory ()
+	{
+		if (memoryBytes < (size_t) MAPPED_MEMORY_SIZE)
+		{
+			delete[] memory;
+		}
+		else
+		{
+			munmap(memory, memoryBytes);
+		}
+		memory = NULL;
+		memoryBytes = 0;
+	}
+
+	// Get number of execution engines
+	const int Microcontroller::numberOfEngines ()
+	{
+		return sizeof(ENGINES) / sizeof(std::string);
+	}
+
+	// Find execution engine by name, return -1 if not found
+	const int Microcontroller::findEngine (const std::string& name)
+	{
+		for (int i = 0; i < numberOfEngines(); i++)
+		{
+			if (name == ENGINES[i])
+			{
+				return i;
+			}
+		}
+
+		return -1;
+	}
+
+	// Execute at most budget instructions from current PC or from a specific
+	// location, stopping once a number of seconds has elapsed (no deadline
+	// if seconds is 0)
+	const int Microcontroller::runWithDeadline (unsigned long long& budget,
+			const double& seconds, const int& location)
+	{
+		// If location is provided, set pc to that
+		if (location != -1)
+		{
+			setPC(location);
+			recordEdit();
+		}
+
+		// If there is no deadline, run the whole budget at once
+		if (seconds <= 0)
+		{
+			return run(budget);
+		}
+
+		// Else, run in slices and check the clock only between them
+		double deadline = now() + seconds;
+		while (true)
+		{
+			// Run next slice and charge it to the budget
+			unsigned long long slice = std::min(budget, DEADLINE_SLICE), left = slice;
+			int signal = run(left);
+			budget -= slice - left;
+
+			// Stop on any other signal, at the end of the budget or after the deadline
+			if (signal != BUDGET_EXHAUSTED || !budget || now() >= deadline)
+			{
+				return signal;
+			}
+		}
+	}
+
+	// Create identifier of a new snapshot, never 0
+	static unsigned int newSnapshotId ()
+	{
+		static thread_local std::mt19937 generator((std::random_device()()));
+		unsigned int id;
+		while (!(id = generator()));
+		return id;
+	}
+
+	// Mark all pages as dirty but untouched, sizing flags to memory. Memory
+	// is reset, so recorded history no longer leads to it
+	void Microcontroller::markAllDirty ()
+	{
+		pageFlags.assign((getMemorySize() + (1 << PAGE_SHIFT) - 1) >> PAGE_SHIFT, PAGE_DIRTY);
+		if (timeline)
+		{
+			timeline->invalidate();
+		}
+	}
+
+	// Zero pages written since reset, then mark all pages as dirty but
+	// untouched. Other pages are still 0, so a large memory is reset in
+	// the time it takes to clear what the program wrote
+	void Microcontroller::clearMemory ()
+	{
+		for (int i = 0; i < (int) pageFlags.size(); i++)
+		{
+			if (pageFlags[i] & PAGE_TOUCHED)
+			{
+				int start = i << PAGE_SHIFT;
+				std::fill(memory + start, memory + std::min(start + (1 << PAGE_SHIFT),
+						getMemorySize()), 0);
+			}
+		}
+		markAllDirty();
+	}
+
+	// Copy PC, registers, engine and touched memory into this reset
+	// microcontroller, untouched pages being 0 on both sides
+	void Microcontroller::copyFrom (const Microcontroller& source)
+	{
+		// Copy PC, registers and engine
+		unsigned char registers[MAX_REGISTERS];
+		pc = source.pc;
+		source.getRegisters(registers);
+		setRegisters(registers);
+		setEngine(source.engine);
+
+		// Copy touched pages only
+		for (int i = 0; i < (int) pageFlags.size(); i++)
+		{
+			if (source.pageFlags[i] & PAGE_TOUCHED)
+			{
+				int start = i << PAGE_SHIFT;
+				std::copy(source.memory + start, source.memory
+						+ std::min(start + (1 << PAGE_SHIFT), getMemorySize()),
+						memory + start);
+			}
+		}
+
+		// Share page flags and snapshot chain, so deltas keep working
+		pageFlags = source.pageFlags;
+		snapshotId = source.snapshotId;
+		snapshotDepth = source.snapshotDepth;
+	}
+
+	// Write current state as binary snapshot to stream, or only the pages
+	// written since the last snapshot as a delta chained to it. An untracked
+	// snapshot is a copy later deltas do not chain to
+	const bool Microcontroller::getSnapshot (std::ostream& stream, const bool& delta,
+			const bool& tracked)
+	{
+		// A delta needs a snapshot to apply to
+		if (delta && !snapshotId)
+		{
+			return false;
+		}
+
+		// Fill in header
+		SnapshotHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+		header.version = SNAPSHOT_VERSION;
+		header.headerSize = sizeof(header);
+		type.copy(header.type, sizeof(header.type) - 1);
+		header.memorySize = getMemorySize();
+		header.pc = pc;
+		header.registerCount = getRegisters(header.registers);
+		header.kind = delta ? DELTA_SNAPSHOT : FULL_SNAPSHOT;
+		header.pageShift = PAGE_SHIFT;
+		header.id = newSnapshotId();
+
+		// Collect pages written since the last snapshot for a delta, or
+		// non-zero pages for a full snapshot, other pages being 0
+		std::vector<unsigned int> pages;
+		for (int i = 0; i < (int) pageFlags.size(); i++)
+		{
+			int start = i << PAGE_SHIFT;
+			bool listed = delta ? (pageFlags[i] & PAGE_DIRTY) != 0 : (pageFlags[i] & PAGE_TOUCHED)
+					&& !isZero(memory + start, std::min(1 << PAGE_SHIFT, getMemorySize() - start));
+			if (listed)
+			{
+				pages.push_back(i);
+			}
+		}
+		if (delta)
+		{
+			header.baseId = snapshotId;
+			header.depth = snapshotDepth + 1;
+		}
+		header.pageCount = pages.size();
+
+		// Write header, page indexes and page contents
+		stream.write((const char *) &header, sizeof(header));
+		if (pages.size())
+		{
+			stream.write((const char *) &pages[0], pages.size() * sizeof(unsigned int));
+		}
+		for (int i = 0; i < (int) pages.size(); i++)
+		{
+			int start = pages[i] << PAGE_SHIFT;
+			stream.write((const char *) memory + start,
+					std::min(1 << PAGE_SHIFT, getMemorySize() - start));
+		}
+
+		// If snapshot is incomplete, keep tracking against the previous one
+		if (!stream.good())
+		{
+			return false;
+		}
+
+		// An untracked copy leaves deltas chained to the previous one
+		if (!tracked)
+		{
+			return true;
+		}
+
+		// Track writes against this snapshot from now on
+		for (int i = 0; i < (int) pageFlags.size(); i++)
+		{
+			pageFlags[i] &= ~PAGE_DIRTY;
+		}
+		snapshotId = header.id;
+		snapshotDepth = header.depth;
+
+		return true;
+	}
+
+	// Set state from binary snapshot stream, return failure (-1)
+	const int Microcontroller::setSnapshot (std::istream& stream)
+	{
+		// Version 1 headers end before the snapshot identifiers
+		const int VERSION_1_SIZE = offsetof(SnapshotHeader, id);
+
+		// If header cannot be read or does not match, return failure (-1)
+		SnapshotHeader header;
+		std::memset(&header, 0, sizeof(header));
+		if (!stream.read((char *) &header, VERSION_1_SIZE)
+				|| std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))
+				|| !((header.version == 1 && header.headerSize == VERSION_1_SIZE
+						&& header.kind == FULL_SNAPSHOT)
+					|| ((header.version == 2 || header.version == SNAPSHOT_VERSION)
+						&& header.headerSize == sizeof(header)
+						&& stream.read((char *) &header + VERSION_1_SIZE,
+								sizeof(header) - VERSION_1_SIZE)))
+				|| type.compare(0, std::string::npos, header.type,
+						strnlen(header.type, sizeof(header.type)))
+				|| header.memorySize != (unsigned int) getMemorySize())
+		{
+			return -1;
+		}
+
+		// If register count does not match, return failure (-1)
+		unsigned char registers[MAX_REGISTERS];
+		if (header.registerCount != getRegisters(registers))
+		{
+			return -1;
+		}
+
+		// If delta does not apply to the current, unmodified state, return
+		// failure (-1)
+		if (header.kind == DELTA_SNAPSHOT)
+		{
+			if (!snapshotId || header.baseId != snapshotId)
+			{
+				return -1;
+			}
+			for (int i = 0; i < (int) pageFlags.size(); i++)
+			{
+				if (pageFlags[i] & PAGE_DIRTY)
+				{
+					return -1;
+				}
+			}
+		}
+		else if (header.kind != FULL_SNAPSHOT)
+		{
+			return -1;
+		}
+
+		// Read page indexes and all page contents at once, so memory is kept
+		// if they are truncated
+		std::vector<unsigned int> pages;
+		std::vector<unsigned char> image;
+		if (header.kind == DELTA_SNAPSHOT || header.version == SNAPSHOT_VERSION)
+		{
+			// Deltas and full snapshots of version 3 list their pages
+			if (header.pageShift != PAGE_SHIFT || header.pageCount > pageFlags.size())
+			{
+				return -1;
+			}
+			pages.resize(header.pageCount);
+			int size = 0;
+			if (pages.size() && !stream.read((char *) &pages[0],
+					pages.size() * sizeof(unsigned int)))
+			{
+				return -1;
+			}
+			for (int i = 0; i < (int) pages.size(); i++)
+			{
+				if (pages[i] >= pageFlags.size())
+				{
+					return -1;
+				}
+				size += std::min(1 << PAGE_SHIFT,
+						getMemorySize() - (int) (pages[i] << PAGE_SHIFT));
+			}
+			image.resize(size);
+			if (size && !stream.read((char *) &image[0], size))
+			{
+				return -1;
+			}
+		}
+		else
+		{
+			// Full snapshots of older versions hold the whole memory image,
+			// packed here into its non-zero pages
+			image.resize(getMemorySize());
+			if (!stream.read((char *) &image[0], image.size()))
+			{
+				return -1;
+			}
+			int size = 0;
+			for (int i = 0; i < (int) pageFlags.size(); i++)
+			{
+				int start = i << PAGE_SHIFT;
+				int length = std::min(1 << PAGE_SHIFT, getMemorySize() - start);
+				if (!isZero(&image[start], length))
+				{
+					std::memmove(&image[size], &image[start], length);
+					pages.push_back(i);
+					size += length;
+				}
+			}
+			image.resize(size);
+		}
+
+		// A full snapshot replaces memory: pages written since reset are
+		// zeroed and only the pages it lists are flagged as touched, so a
+		// large memory stays sparse
+		if (header.kind == FULL_SNAPSHOT)
+		{
+			clearMemory();
+			std::fill(pageFlags.begin(), pageFlags.end(), 0);
+		}
+
+		// Copy pages
+		for (int i = 0, offset = 0; i < (int) pages.size(); i++)
+		{
+			int start = pages[i] << PAGE_SHIFT;
+			int length = std::min(1 << PAGE_SHIFT, getMemorySize() - start);
+			std::copy(&image[offset], &image[offset] + length, memory + start);
+			pageFlags[pages[i]] |= PAGE_TOUCHED;
+			offset += length;
+		}
+
+		// Restore PC and registers
+		pc = header.pc;
+		setRegisters(header.registers);
+		memoryLoaded();
+		if (timeline)
+		{
+			timeline->invalidate();
+		}
+
+		// Track writes against this snapshot from now on
+		snapshotId = header.id;
+		snapshotDepth = header.depth;
+
+		// If no error occurs, return success (0)
+		return 0;
+	}
+
+	// Check if a stream starts with a binary snapshot
+	const bool Microcontroller::isSnapshot (std::istream& stream)
+	{
+		// Peek at leading bytes and rewind
+		char magic[sizeof(SNAPSHOT_MAGIC)];
+		std::streampos start = stream.tellg();
+		bool found = stream.read(magic, sizeof(magic))
+				&& !std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic));
+		stream.clear();
+		stream.seekg(start);
+
+		return found;
+	}
+
+	// Set state from binary snapshot or text stream, return failure
+	// (-1 for snapshots, failing line for text)
+	const int Microcontroller::loadState (std::istream& stream)
+	{
+		// If stream is a snapshot, load it
+		if (isSnapshot(stream))
+		{
+			return setSnapshot(stream);
+		}
+
+		// Else, load text state, which deltas cannot chain to nor recorded
+		// history lead to
+		snapshotId = 0;
+		snapshotDepth = 0;
+		if (timeline)
+		{
+			timeline->invalidate();
+		}
+		return setState(stream);
+	}
+
+	// Reset execution counters
+	void Microcontroller::resetStatistics ()
+	{
+		std::memset(&statistics, 0, sizeof(statistics));
+	}
+
+	// Return execution counters
+	const std::string Microcontroller::statisticsString () const
+	{
+		// Create output string stream
+		std::ostringstream stream;
+
+		// Sum data memory accesses of every opcode
+		unsigned long long reads = 0, writes = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			const InstructionInfo * info = describeInstruction(i);
+			if (info && statistics.opcodes[i])
+			{
+				reads += statistics.opcodes[i] * info->reads;
+				writes += statistics.opcodes[i] * info->writes;
+			}
+		}
+
+		// Add counters to string stream
+		stream << "Statistics" << (isInstrumented() ? "" : " (stopped)") << ":\n"
+			   << " - Instructions retired: " << statistics.instructions << '\n'
+			   << " - Execution calls: " << statistics.calls << ", "
+			   << statistics.seconds << " s in total, "
+			   << statistics.lastSeconds << " s in the last one\n"
+			   << " - Throughput: "
+			   << (statistics.seconds > 0 ? statistics.instructions / statistics.seconds : 0)
+			   << " instructions/s\n"
+			   << " - Branches: " << statistics.taken << " taken, "
+			   << statistics.notTaken << " not taken\n"
+			   << " - Memory: " << reads << " reads, " << writes << " writes\n"
+			   << " - Opcodes:\n";
+
+		// Add count of every opcode executed
+		for (int i = 0; i < 256; i++)
+		{
+			if (statistics.opcodes[i])
+			{
+				const InstructionInfo * info = describeInstruction(i);
+				stream << "   0x" << std::hex << std::setw(2) << std::setfill('0') << i
+					   << ' ' << std::left << std::setw(6) << std::setfill(' ')
+					   << (info ? info->mnemonic : "?") << std::right << std::dec
+					   << statistics.opcodes[i] << '\n';
+			}
+		}
+
+		// Return statistics string
+		return stream.str();
+	}
+
+	// Get target of the branch at a location, return -1 if it is not a branch
+	const int Microcontroller::branchTarget (const int& location) const
+	{
+		const InstructionInfo * info = describeInstruction(look(location));
+		if (!info)
+		{
+			return -1;
+		}
+
+		// Find absolute or relative target operand
+		int offset;
+		if ((offset = operandOffset(*info, 't')))
+		{
+			return ((int) look(location + offset) << 8) | look(location + offset + 1);
+		}
+		if ((offset = operandOffset(*info, 'r')))
+		{
+			return location + (int)((char) look(location + offset));
+		}
+
+		return -1;
+	}
+
+	// Get offset of the first operand of a kind after the opcode, 0 if none
+	const int Microcontroller::operandOffset (const InstructionInfo& info, const char& kind)
+	{
+		// Operands follow the opcode byte, addresses and targets take 2 bytes
+		for (int i = 0, offset = 1; info.operands[i]; i++)
+		{
+			if (info.operands[i] == kind)
+			{
+				return offset;
+			}
+			offset += info.operands[i] == 'a' || info.operands[i] == 't' ? 2 : 1;
+		}
+
+		return 0;
+	}
+
+	// Return instruction at a location in assembler form
+	const std::string Microcontroller::disassemble (const int& location) const
+	{
+		// Create output string stream
+		std::ostringstream stream;
+		stream << std::hex << std::setfill('0')
+			   << "0x" << std::setw(3) << location << "  ";
+
+		// Invalid opcodes are shown as data bytes
+		unsigned char opcode = look(location);
+		const InstructionInfo * info = describeInstruction(opcode);
+		if (!info)
+		{
+			stream << "DB 0x" << std::setw(2) << (int) opcode;
+			return stream.str();
+		}
+
+		// Add mnemonic and operands, operands follow the opcode byte
+		stream << info->mnemonic;
+		for (int i = 0, offset = 1; info->operands[i]; i++)
+		{
+			stream << (i ? ", " : " ");
+			switch (info->operands[i])
+			{
+				case 'a':
+					stream << "[0x" << std::setw(3) << (((int) look(location + offset) << 8)
+							| look(location + offset + 1)) << ']';
+					offset += 2;
+					break;
+				case 't':
+				case 'r':
+					stream << "0x" << std::setw(3) << branchTarget(location);
+					offset += info->operands[i] == 't' ? 2 : 1;
+					break;
+				default:
+					stream << "0x" << std::setw(2) << (int) look(location + offset);
+					offset++;
+			}
+		}
+
+		// Return instruction string
+		return stream.str();
+	}
+
+	// Hexadecimal digit pairs of all byte values
+	struct HexPairs
+	{
+		char digits[512];
+
+		constexpr HexPairs () : digits()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				digits[2 * i] = "0123456789abcdef"[i >> 4];
+				digits[2 * i + 1] = "0123456789abcdef"[i & 0xF];
+			}
+		}
+	};
+	static constexpr HexPairs HEX_PAIRS;
+
+	// Return memory rows from start to end as a hexadecimal dump. The dump is
+	// formatted in place into a buffer sized for the worst case, bytes being
+	// converted by table. A run of all-zero rows shows its first row followed
+	// by "*"; pages never written are known to be 0 and skipped unread
+	const std::string Microcontroller::dumpMemory (const int& start, const int& end) const
+	{
+		const int size = getMemorySize();
+		const int first = start & ~0xF;
+		const int last = std::min(end, size - 1);
+		const int pageSize = 1 << PAGE_SHIFT;
+
+		// Addresses have at least 4 digits, more if the memory needs them
+		int width = 4;
+		while (width < 8 && ((size - 1) >> (width * 4)))
+		{
+			width++;
+		}
+
+		// Column header, then one row per 16 bytes
+		const int rowLength = width + 51;
+		const int rows = last >= first ? (last - first) / 0x10 + 1 : 0;
+		std::string output(rowLength + 1 + (size_t) rows * rowLength, ' ');
+		char * out = &output[0] + width;
+		for (int i = 0; i < 0x10; i++)
+		{
+			// Separate display by byte
+			out += i == 0 || i == 8 ? 2 : 1;
+			out[0] = '0';
+			out[1] = HEX_PAIRS.digits[2 * i + 1];
+			out += 2;
+		}
+		*out++ = '\n';
+		*out++ = '\n';
+
+		const unsigned char * memory = getMemory();
+		const unsigned char * flags = getPageFlags();
+		bool zero = false;	// Whether the previous row is all 0
+		bool collapsed = false;	// Whether "*" stands for the current run
+		for (int address = first; address <= last;)
+		{
+			// Skip a whole untouched page within a run of zero rows
+			bool touched = flags[address >> PAGE_SHIFT] & PAGE_TOUCHED;
+			if (zero && !touched && !(address & (pageSize - 1))
+					&& address + pageSize - 1 <= last)
+			{
+				if (!collapsed)
+				{
+					*out++ = '*';
+					*out++ = '\n';
+					collapsed = true;
+				}
+				address += pageSize;
+				continue;
+			}
+
+			// Check whether the row is all 0, reading touched pages only
+			const int count = std::min(0x10, size - address);
+			const unsigned char * row = memory + address;
+			bool rowZero = !touched;
+			if (touched && count == 0x10)
+			{
+				unsigned long long low, high;
+				memcpy(&low, row, 8);
+				memcpy(&high, row + 8, 8);
+				rowZero = !(low | high);
+			}
+			else if (touched)
+			{
+				rowZero = std::count(row, row + count, 0) == count;
+			}
+
+			// Collapse repeated zero rows
+			if (zero && rowZero)
+			{
+				if (!collapsed)
+				{
+					*out++ = '*';
+					*out++ = '\n';
+					collapsed = true;
+				}
+				address += 0x10;
+				continue;
+			}
+			zero = rowZero;
+			collapsed = false;
+
+			// Row header, then row content
+			for (int i = width - 1; i >= 0; i--)
+			{
+				*out++ = HEX_PAIRS.digits[2 * ((address >> (i * 4)) & 0xF) + 1];
+			}
+			for (int j = 0; j < count; j++)
+			{
+				// Separate display by byte
+				out += j == 0 || j == 8 ? 2 : 1;
+				out[0] = HEX_PAIRS.digits[2 * row[j]];
+				out[1] = HEX_PAIRS.digits[2 * row[j] + 1];
+				out += 2;
+			}
+			*out++ = '\n';
+			address += 0x10;
+		}
+
+		// Return dump without the unused part of the buffer
+		output.resize(out - &output[0]);
+		return output;
+	}
+
+	// Search memory for a byte pattern. The pattern byte with the most bits
+	// compared is the anchor, scanned for with vector instructions, and the
+	// whole pattern is only compared where it is found. Untouched pages are
+	// 0, so they are not scanned for an anchor of another value
+	const int Microcontroller::searchMemory (const std::vector<unsigned char>& pattern,
+			const std::vector<unsigned char>& mask, std::vector<int>& matches,
+			const int& maximum) const
+	{
+		const int size = getMemorySize();
+		const int length = pattern.size();
+		matches.clear();
+		if (!length || length > size)
+		{
+			return 0;
+		}
+
+		// Bits compared of every pattern byte, and the anchor
+		std::vector<unsigned char> bits(length, 0xFF);
+		std::copy(mask.begin(), mask.begin() + std::min((int) mask.size(), length),
+				bits.begin());
+		int anchor = 0;
+		for (int i = 1; i < length; i++)
+		{
+			if (__builtin_popcount(bits[i]) > __builtin_popcount(bits[anchor]))
+			{
+				anchor = i;
+			}
+		}
+		const unsigned char value = pattern[anchor] & bits[anchor];
+
+		// Scan locations the anchor can be at
+		const unsigned char * memory = getMemory();
+		const unsigned char * flags = getPageFlags();
+		const int last = size - length + anchor;
+		int count = 0, end = 0;
+		for (int location = anchor; location <= last;)
+		{
+			// Scan to the end of memory, or of the run of touched pages if
+			// the anchor is not 0
+			if (location >= end)
+			{
+				end = last + 1;
+				if (value)
+				{
+					int page = location >> PAGE_SHIFT;
+					if (!(flags[page] & PAGE_TOUCHED))
+					{
+						location = (page + 1) << PAGE_SHIFT;
+						continue;
+					}
+					while (((page + 1) << PAGE_SHIFT) < end && (flags[page + 1] & PAGE_TOUCHED))
+					{
+						page++;
+					}
+					end = std::min(end, (page + 1) << PAGE_SHIFT);
+				}
+			}
+
+			int found = MemoryScanner::findByte(memory + location, end - location,
+					value, bits[anchor]);
+			if (found < 0)
+			{
+				location = end;
+				continue;
+			}
+			location += found;
+
+			// Compare whole pattern around the anchor
+			const unsigned char * candidate = memory + location - anchor;
+			int i = 0;
+			while (i < length && !((candidate[i] ^ pattern[i]) & bits[i]))
+			{
+				i++;
+			}
+			if (i == length)
+			{
+				if (count < maximum)
+				{
+					matches.push_back(location - anchor);
+				}
+				count++;
+			}
+			location++;
+		}
+
+		return count;
+	}
+
+	// Return ranges [start, end) where memory differs from another
+	// microcontroller's. Pages neither has touched are 0 on both sides and
+	// skipped, the others are scanned for the first difference, then for
+	// the first equal byte ending the range
+	const std::vector<std::pair<int, int> > Microcontroller::compareMemory (
+			const Microcontroller& other) const
+	{
+		std::vector<std::pair<int, int> > ranges;
+		const int size = std::min(getMemorySize(), other.getMemorySize());
+		const unsigned char * memory = getMemory();
+		const unsigned char * otherMemory = other.getMemory();
+		const unsigned char * flags = getPageFlags();
+		const unsigned char * otherFlags = other.getPageFlags();
+
+		for (int location = 0, end = 0; location < size;)
+		{
+			// Find run of pages touched by either side
+			if (location >= end)
+			{
+				int page = location >> PAGE_SHIFT;
+				if (!((flags[page] | otherFlags[page]) & PAGE_TOUCHED))
+				{
+					location = (page + 1) << PAGE_SHIFT;
+					continue;
+				}
+				while (((page + 1) << PAGE_SHIFT) < size
+						&& ((flags[page + 1] | otherFlags[page + 1]) & PAGE_TOUCHED))
+				{
+					page++;
+				}
+				end = std::min(size, (page + 1) << PAGE_SHIFT);
+			}
+
+			// Find first difference in the run
+			int found = MemoryScanner::findDifference(memory + location,
+					otherMemory + location, end - location);
+			if (found < 0)
+			{
+				location = end;
+				continue;
+			}
+			location += found;
+
+			// Range ends at the next equal byte
+			found = MemoryScanner::findEquality(memory + location,
+					otherMemory + location, size - location);
+			int stop = found < 0 ? size : location + found;
+			ranges.push_back(std::make_pair(location, stop));
+			location = stop;
+		}
+
+		// Excess of the larger memory
+		int larger = std::max(getMemorySize(), other.getMemorySize());
+		if (larger > size)
+		{
+			ranges.push_back(std::make_pair(size, larger));
+		}
+
+		return ranges;
+	}
+
+	// Return 64-bit digest of PC, registers and memory, equal for equal
+	// states whichever pages were written: pages of zeros are skipped,
+	// others are mixed in with their index, 8 bytes at a time
+	const unsigned long long Microcontroller::digest () const
+	{
+		const unsigned long long PRIME = 0x100000001B3ULL;
+		unsigned long long hash = 0xCBF29CE484222325ULL;
+
+		// Mix PC and registers
+		unsigned char registers[MAX_REGISTERS];
+		int count = getRegisters(registers);
+		hash = (hash ^ (unsigned int) pc) * PRIME;
+		for (int i = 0; i < count; i++)
+		{
+			hash = (hash ^ registers[i]) * PRIME;
+		}
+
+		// Mix non-zero pages, untouched pages being 0
+		for (int i = 0; i < (int) pageFlags.size(); i++)
+		{
+			int start = i << PAGE_SHIFT;
+			int length = std::min(1 << PAGE_SHIFT, getMemorySize() - start);
+			if (!(pageFlags[i] & PAGE_TOUCHED) || isZero(memory + start, length))
+			{
+				continue;
+			}
+
+			hash = (hash ^ i) * PRIME;
+			for (int j = 0; j < length; j += 8)
+			{
+				unsigned long long word = 0;
+				std::memcpy(&word, memory + start + j, std::min(8, length - j));
+				hash = (hash ^ word) * PRIME;
+				hash ^= hash >> 29;
+			}
+		}
+
+		return hash;
+	}
+
+	// Add a breakpoint on PCs or a watchpoint on memory locations from start
+	// to end, and arm its kind at each location, return false if the range
+	// or kind is invalid
+	const bool Microcontroller::addBreakpoint (const int& start, const int& end,
+			const int& kind)
+	{
+		if (start < 0 || end < start || end >= getMemorySize()
+				|| !(kind == BREAKPOINT || (kind && !(kind & ~(WATCH_READ | WATCH_WRITE)))))
+		{
+			return false;
+		}
+
+		Breakpoint breakpoint = {start, end, kind};
+		breakpoints.push_back(breakpoint);
+		breakFlags.resize(getMemorySize(), 0);
+		for (int i = start; i <= end; i++)
+		{
+			breakFlags[i] |= kind;
+		}
+		return true;
+	}
+
+	// Remove a breakpoint or watchpoint by index, and re-arm the remaining
+	// ones, return false if not found
+	const bool Microcontroller::removeBreakpoint (const int& index)
+	{
+		if (index < 0 || index >= (int) breakpoints.size())
+		{
+			return false;
+		}
+
+		std::vector<Breakpoint> remaining(breakpoints);
+		remaining.erase(remaining.begin() + index);
+		clearBreakpoints();
+		for (int i = 0; i < (int) remaining.size(); i++)
+		{
+			addBreakpoint(remaining[i].start, remaining[i].end, remaining[i].kind);
+		}
+		return true;
+	}
+
+	// Remove all breakpoints and watchpoints
+	void Microcontroller::clearBreakpoints ()
+	{
+		breakpoints.clear();
+		std::vector<unsigned char>().swap(breakFlags);
+		resumePC = -1;
+	}
+
+	// Record a stop at a breakpoint before pc, which execution passes when
+	// resuming from it, or at a watchpoint after the instruction at pc
+	// accessed a location
+	void Microcontroller::stopAtBreak (const int& pc, const int& location,
+			const int& kind)
+	{
+		breakPC = pc;
+		breakLocation = location;
+		breakKind = kind;
+		resumePC = kind == BREAKPOINT ? pc : -1;
+	}
+
+	// Return description of the last stop at a breakpoint or watchpoint
+	const std::string Microcontroller::breakString () const
+	{
+		std::ostringstream stream;
+		stream << std::hex << std::setfill('0');
+		if (breakKind == BREAKPOINT)
+		{
+			stream << "Breakpoint. Program Counter = 0x" << std::setw(2) << getPC();
+		}
+		else
+		{
+			stream << "Watchpoint. "
+				   << (breakKind & WATCH_WRITE ? "Write" : "Read")
+				   << " of 0x" << std::setw(2) << breakLocation
+				   << " by instruction at 0x" << std::setw(2) << breakPC
+				   << ". Program Counter = 0x" << std::setw(2) << getPC();
+		}
+		return stream.str();
+	}
+
+	// Start sampling the PC every interval microseconds
+	void Microcontroller::startProfiler (const int& interval)
+	{
+		// Create profiler on first use
+		if (!profiler)
+		{
+			profiler = new Profiler(this);
+		}
+
+		// Start a new profile
+		profiler->stop();
+		profiler->reset();
+		profiled = true;
+		profiler->start(interval);
+	}
+
+	// Stop sampling the PC, keeping the samples
+	void Microcontroller::stopProfiler ()
+	{
+		profiled = false;
+		if (profiler)
+		{
+			profiler->stop();
+		}
+	}
+
+	// Return hottest addresses and loops of the samples
+	const std::string Microcontroller::profileString (const int& top) const
+	{
+		return profiler ? profiler->reportString(top) : "Profile: no samples\n";
+	}
+
+	// Start recording executed instructions into a new ring buffer keeping
+	// at least capacity records
+	void Microcontroller::startTrace (const unsigned int& capacity)
+	{
+		delete tracer;
+		tracer = new Tracer(capacity);
+		traced = true;
+	}
+
+	// Stop recording, keeping the records
+	void Microcontroller::stopTrace ()
+	{
+		traced = false;
+	}
+
+	// Get number of instructions recorded since the trace started
+	const unsigned long long Microcontroller::getTraceCount () const
+	{
+		return tracer ? tracer->getCount() : 0;
+	}
+
+	// Write records kept to stream, return false if there is no trace
+	const bool Microcontroller::dumpTrace (std::ostream& stream) const
+	{
+		unsigned char registers[MAX_REGISTERS];
+		return tracer && tracer->dump(stream, type, getRegisters(registers));
+	}
+
+	// Start recording a checkpoint every interval instructions, pages of
+	// checkpoints taking at most limit bytes before the oldest are dropped
+	void Microcontroller::startRecording (const unsigned long long& interval,
+			const size_t& limit)
+	{
+		delete timeline;
+		timeline = new Timeline(std::max(interval, 1ULL), limit);
+		beginRecording();
+	}
+
+	// Stop recording, dropping the checkpoints
+	void Microcontroller::stopRecording ()
+	{
+		delete timeline;
+		timeline = NULL;
+	}
+
+	// Get number of instructions executed since recording started
+	const unsigned long long Microcontroller::getRecordedTime () const
+	{
+		return timeline ? timeline->getTime() : 0;
+	}
+
+	// Get earliest time execution can go back to
+	const unsigned long long Microcontroller::getOldestTime () const
+	{
+		return timeline ? timeline->getOldestTime() : 0;
+	}
+
+	// Get bytes held by checkpoints
+	const size_t Microcontroller::getRecordedBytes () const
+	{
+		return timeline ? timeline->getBytes() : 0;
+	}
+
+	// Prepare recording before executing, restarting it from the current
+	// state if its history no longer leads to it, and taking a checkpoint
+	// if the state was changed outside execution
+	void Microcontroller::beginRecording ()
+	{
+		if (!timeline->isValid())
+		{
+			for (int i = 0; i < (int) pageFlags.size(); i++)
+			{
+				pageFlags[i] &= ~PAGE_CHECKPOINT;
+			}
+			timeline->start(memory, &pageFlags[0], getMemorySize());
+		}
+		if (timeline->isCheckpointDue())
+		{
+			takeCheckpoint();
+		}
+	}
+
+	// Get instructions to execute until the next periodic checkpoint
+	const unsigned long long Microcontroller::untilCheckpoint () const
+	{
+		return timeline->untilCheckpoint();
+	}
+
+	// Advance recording by instructions executed, taking a checkpoint when
+	// one is due, or before the next execution if it stopped on a signal,
+	// as the instruction raising it may have changed the state
+	void Microcontroller::advanceRecording (const unsigned long long& executed,
+			const int& signal)
+	{
+		timeline->setTime(timeline->getTime() + executed);
+		if (signal != BUDGET_EXHAUSTED)
+		{
+			timeline->setCheckpointDue(true);
+		}
+		else if (executed && !(timeline->getTime() % timeline->getInterval()))
+		{
+			takeCheckpoint();
+		}
+	}
+
+	// Note a change of memory or PC made outside execution, so recording
+	// takes a checkpoint before executing again
+	void Microcontroller::recordEdit ()
+	{
+		if (isRecording())
+		{
+			timeline->setCheckpointDue(true);
+		}
+	}
+
+	// Take a checkpoint of PC, registers and pages written since the last
+	// one, found by their PAGE_CHECKPOINT flag
+	void Microcontroller::takeCheckpoint ()
+	{
+		Checkpoint checkpoint;
+		checkpoint.time = timeline->getTime();
+		checkpoint.pc = pc;
+		std::memset(checkpoint.registers, 0, sizeof(checkpoint.registers));
+		getRegisters(checkpoint.registers);
+
+		// Copy flagged pages and clear their flag
+		const int count = pageFlags.size();
+		for (int i = 0; i < count; i++)
+		{
+			int found = MemoryScanner::findByte(&pageFlags[i], count - i,
+					PAGE_CHECKPOINT, PAGE_CHECKPOINT);
+			if (found < 0)
+			{
+				break;
+			}
+			i += found;
+			pageFlags[i] &= ~PAGE_CHECKPOINT;
+			checkpoint.pages.push_back(i);
+			int start = i << PAGE_SHIFT;
+			checkpoint.data.insert(checkpoint.data.end(), memory + start,
+					memory + std::min(start + (1 << PAGE_SHIFT), getMemorySize()));
+		}
+
+		timeline->add(checkpoint);
+	}
+
+	// Restore memory, PC and registers of a recorded checkpoint in place.
+	// Only pages written since the last checkpoint or recorded by the
+	// timeline can differ, of which those that do are copied and marked
+	// dirty, and pages untouched at the checkpoint become untouched again
+	void Microcontroller::restoreCheckpoint (const int& index)
+	{
+		// Find pages written since the last checkpoint
+		std::unordered_map<int, const unsigned char *> pages;
+		const int count = pageFlags.size();
+		for (int i = 0; i < count; i++)
+		{
+			int found = MemoryScanner::findByte(&pageFlags[i], count - i,
+					PAGE_CHECKPOINT, PAGE_CHECKPOINT);
+			if (found < 0)
+			{
+				break;
+			}
+			i += found;
+			pages.emplace(i, (const unsigned char *) NULL);
+		}
+
+		// Get their content at the checkpoint, with the pages recorded
+		timeline->contentAt(index, pages);
+
+		std::unordered_map<int, const unsigned char *>::const_iterator page;
+		for (page = pages.begin(); page != pages.end(); ++page)
+		{
+			int i = page->first, start = i << PAGE_SHIFT;
+			int length = std::min(1 << PAGE_SHIFT, getMemorySize() - start);
+			const unsigned char * content = page->second;
+
+			// Pages untouched at the checkpoint are 0, as are pages
+			// untouched now
+			if (content ? std::memcmp(memory + start, content, length) != 0
+					: (pageFlags[i] & PAGE_TOUCHED) && !isZero(memory + start, length))
+			{
+				if (content)
+				{
+					std::memcpy(memory + start, content, length);
+				}
+				else
+				{
+					std::memset(memory + start, 0, length);
+				}
+				pageFlags[i] |= PAGE_DIRTY;
+			}
+			pageFlags[i] = (pageFlags[i] & PAGE_DIRTY) | (content ? PAGE_TOUCHED : 0);
+		}
+
+		// Restore PC and registers
+		const Checkpoint& checkpoint = timeline->get(index);
+		pc = checkpoint.pc;
+		setRegisters(checkpoint.registers);
+		memoryLoaded();
+		timeline->setCheckpointDue(false);
+	}
+
+	// Execute a number of instructions without recording or breakpoints
+	const int Microcontroller::replay (unsigned long long count)
+	{
+		if (!count)
+		{
+			return BUDGET_EXHAUSTED;
+		}
+
+		replaying = true;
+		int signal = run(count);
+		replaying = false;
+		return signal;
+	}
+
+	// Go back to a recorded time, restoring the checkpoint before it and
+	// replaying instructions up to it, return false if not recorded. Later
+	// checkpoints are dropped, as execution goes on from there
+	const bool Microcontroller::travelTo (const unsigned long long& time)
+	{
+		if (!timeline || !timeline->isValid() || time < timeline->getOldestTime()
+				|| time > timeline->getTime())
+		{
+			return false;
+		}
+
+		int index = timeline->find(time);
+		restoreCheckpoint(index);
+		timeline->truncate(index);
+		replay(time - timeline->get(index).time);
+		timeline->setTime(time);
+
+		// Resume past a breakpoint at PC
+		resumePC = pc;
+		return true;
+	}
+
+	// Go back to the last instruction that wrote a memory location, before
+	// it executes, and set time to its time, return false if none was
+	// recorded, the current state being kept. Intervals between checkpoints
+	// are searched from the latest, skipping those that did not write the
+	// page of the location, and replayed one instruction at a time
+	const bool Microcontroller::findLastWrite (const int& location,
+			unsigned long long& time)
+	{
+		if (!timeline || !timeline->isValid() || location < 0
+				|| location >= getMemorySize())
+		{
+			return false;
+		}
+
+		// Take a checkpoint now, so the latest interval ends at one
+		unsigned long long present = timeline->getTime();
+		takeCheckpoint();
+
+		int page = location >> PAGE_SHIFT;
+		for (int i = timeline->getCount() - 1; i > 0; i--)
+		{
+			const std::vector<int>& pages = timeline->get(i).pages;
+			if (!std::binary_search(pages.begin(), pages.end(), page))
+			{
+				continue;
+			}
+
+			// Replay interval, keeping time of its last write to location
+			unsigned long long start = timeline->get(i - 1).time;
+			unsigned long long end = timeline->get(i).time, found = end;
+			restoreCheckpoint(i - 1);
+			for (unsigned long long at = start; at < end; at++)
+			{
+				const InstructionInfo * info = describeInstruction(look(pc));
+				int offset;
+				if (info && info->writes && (offset = operandOffset(*info, 'a'))
+						&& (((int) look(pc + offset) << 8) | look(pc + offset + 1)) == location)
+				{
+					found = at;
+				}
+				if (replay(1) != BUDGET_EXHAUSTED)
+				{
+					break;
+				}
+			}
+
+			if (found < end)
+			{
+				travelTo(found);
+				time = found;
+				return true;
+			}
+		}
+
+		// If no write is recorded, come back to the present
+		travelTo(present);
+		return false;
 	}
 }
 
@@ -9,38 +9,219 @@
 #define SRC_MICROCONTROLLER_H_
 
 #include <string>
+#include <vector>
 #include <iostream>
+#include <atomic>
+#include <utility>
+
+// Build with -DMICROCONTROLLER_STATISTICS=0 to compile execution
+// instrumentation out
+#ifndef MICROCONTROLLER_STATISTICS
+#define MICROCONTROLLER_STATISTICS 1
+#endif
 
 namespace MicrocontrollerEmulation {
 
+class Profiler;
+class Tracer;
+class Timeline;
+
 class Microcontroller {
 
 private:
 	int pc;	// Program Counter (PC)
 	unsigned char * memory;	// Memory pointer
+	size_t memoryBytes;	// Bytes allocated for memory, mapped if at least MAPPED_MEMORY_SIZE
 	std::string type;	// Microcontroller type
+	int engine;	// Execution engine
+	std::vector<unsigned char> pageFlags;	// PAGE_DIRTY and PAGE_TOUCHED flags, one byte per page
+	unsigned int snapshotId;	// Identifier of the last snapshot saved or loaded, 0 if none
+	unsigned int snapshotDepth;	// Number of deltas between that snapshot and its full base
+	bool instrumented;	// Whether execution is counted
+	bool profiled;	// Whether the PC is published for the profiler
+	std::atomic<int> sampledPC;	// PC published for the profiler while executing, -1 otherwise
+	Profiler * profiler;	// Sampling profiler, NULL until started
+	bool traced;	// Whether executed instructions are recorded
+	Tracer * tracer;	// Execution trace ring buffer, NULL until started
 
 public:
 	enum {
-		SUCCESS, SIGWEED, SIGOP, HALT
+		SUCCESS, SIGWEED, SIGOP, HALT, BUDGET_EXHAUSTED, BREAK
 	};	// Execution signals
+	static const std::string SIGNALS[];	// Names of execution signals
+	enum {
+		INTERPRETER, THREADED, JIT
+	};	// Execution engines
+	static const std::string ENGINES[];	// Names of execution engines
+	static const char SNAPSHOT_MAGIC[4];	// Leading bytes of binary snapshots
+	static const unsigned short SNAPSHOT_VERSION;	// Version of binary snapshot format
+	static const int MAX_REGISTERS = 8;	// Maximum number of register bytes in a snapshot
+	static const int PAGE_SHIFT = 6;	// Pages are 1 << PAGE_SHIFT bytes
+	static const int MAX_MEMORY_SIZE = 1 << 24;	// Largest memory size
+	static const int MAPPED_MEMORY_SIZE = 1 << 16;	// Memories at least this large are mapped, their pages being committed on first write
+
+	// Static description of an opcode
+	struct InstructionInfo {
+		const char * mnemonic;	// Assembler name
+		const char * operands;	// Operand bytes: 'b' immediate byte, 'a' 16-bit data address, 't' 16-bit branch target, 'r' relative branch offset
+		int length;	// Length in bytes, with operands
+		int reads, writes;	// Data memory reads and writes
+		bool branch;	// Whether it is a conditional or relative branch
+	};
+
+	// Execution counters, collected while instrumented
+	struct Statistics {
+		unsigned long long instructions;	// Instructions retired
+		unsigned long long opcodes[256];	// Instructions retired per opcode
+		unsigned long long taken, notTaken;	// Branches taken and not taken
+		unsigned long long calls;	// Number of execution calls
+		double seconds, lastSeconds;	// Wall time of all execution calls and of the last one
+	};
+	enum {
+		PAGE_DIRTY = 1, PAGE_TOUCHED = 2, PAGE_CHECKPOINT = 4,
+		PAGE_WRITTEN = PAGE_DIRTY | PAGE_TOUCHED | PAGE_CHECKPOINT
+	};	// Page flags: written since the last snapshot, since reset, since the last checkpoint, and all three
+	enum {
+		BREAKPOINT = 1, WATCH_READ = 2, WATCH_WRITE = 4
+	};	// Kinds of breakpoint: before executing a PC, after reading or writing memory
+
+	// Breakpoint on PCs or watchpoint on memory locations
+	struct Breakpoint {
+		int start, end;	// First and last location
+		int kind;	// BREAKPOINT, or WATCH_READ and/or WATCH_WRITE
+	};
+
+private:
+	enum {
+		FULL_SNAPSHOT, DELTA_SNAPSHOT
+	};	// Snapshot kinds
+
+	// Header of binary snapshot (fields are in host byte order). A delta,
+	// or a full snapshot from version 3 onwards, is followed by pageCount
+	// 32-bit page indexes and the content of those pages: the pages written
+	// since the last snapshot for a delta, the non-zero pages for a full
+	// snapshot. A full snapshot of versions 1 and 2 is followed by the raw
+	// memory image
+	struct SnapshotHeader {
+		char magic[4];	// SNAPSHOT_MAGIC
+		unsigned short version;	// SNAPSHOT_VERSION
+		unsigned short headerSize;	// Size of this header
+		char type[16];	// Microcontroller type, zero-padded
+		unsigned int memorySize;	// Size of memory image
+		int pc;	// Program Counter
+		unsigned char registerCount;	// Number of register bytes in use
+		unsigned char registers[MAX_REGISTERS];	// Register bytes
+		unsigned char kind;	// Full snapshot or delta (0 in version 1)
+		unsigned char pageShift;	// PAGE_SHIFT of the pages listed
+		unsigned char reserved;	// Zero padding
+		unsigned int id;	// Identifier of this snapshot (version 2 onwards)
+		unsigned int baseId;	// Identifier of the snapshot a delta applies to
+		unsigned int depth;	// Number of deltas from the full base
+		unsigned int pageCount;	// Number of pages listed
+	};
+
+	std::vector<Breakpoint> breakpoints;	// Breakpoints and watchpoints, in order of creation
+	std::vector<unsigned char> breakFlags;	// Kinds armed at each memory location, empty if none
+	int resumePC;	// PC of the breakpoint execution stopped at, passed when resuming, -1 if none
+	int breakPC, breakLocation, breakKind;	// Instruction, location and kind of the last stop at a breakpoint
+	Timeline * timeline;	// Checkpoints of execution while recording, NULL until started
+	bool replaying;	// Whether execution replays recorded instructions
+
+	// Take a checkpoint of PC, registers and pages written since the last one
+	void takeCheckpoint();
+	// Restore memory, PC and registers of a recorded checkpoint
+	void restoreCheckpoint(const int& index);
+	// Execute a number of instructions without recording or breakpoints
+	const int replay(unsigned long long count);
+
+	friend class MicrocontrollerFactory;
 
 public:
 	Microcontroller(const std::string& typeInput) :
-			memory(NULL), type(typeInput) {
+			memory(NULL), memoryBytes(0), type(typeInput), engine(INTERPRETER),
+			snapshotId(0), snapshotDepth(0), instrumented(false),
+			profiled(false), sampledPC(-1), profiler(NULL),
+			traced(false), tracer(NULL), resumePC(-1), breakPC(-1), breakLocation(-1),
+			breakKind(0), timeline(NULL), replaying(false) {
+		resetStatistics();
 	}	// Constructor with type name
-	~Microcontroller();	// Destructor
+	virtual ~Microcontroller();	// Destructor
+
+	// Get number of execution engines
+	static const int numberOfEngines();
+	// Find execution engine by name, return -1 if not found
+	static const int findEngine(const std::string& name);
 
 protected:
 	void setPC(const int& location) {
 		pc = location;
 	}	// Set PC value
-	void setMemory(unsigned char * pointer) {
-		memory = pointer;
-	}	// Set memory pointer
+	void allocateMemory(const size_t& bytes);	// Allocate zeroed memory, releasing any previous one
+	void releaseMemory();	// Release memory
 	unsigned char * getMemory() const {
 		return memory;
 	}	// Get memory pointer
+	void markDirty(const int& location) {
+		pageFlags[location >> PAGE_SHIFT] = PAGE_WRITTEN;
+	}	// Mark page of a memory location as written
+	unsigned char * getPageFlags() {
+		return &pageFlags[0];
+	}	// Get page flags
+	const unsigned char * getPageFlags() const {
+		return &pageFlags[0];
+	}	// Get page flags
+	void markAllDirty();	// Mark all pages as dirty but untouched, sizing flags to memory
+	void clearMemory();	// Zero pages written since reset, then mark all pages as dirty but untouched
+	void copyFrom(const Microcontroller& source);	// Copy PC, registers, engine and touched memory into this reset microcontroller
+	Statistics statistics;	// Execution counters
+	void publishPC(const int& location) {
+		sampledPC.store(location, std::memory_order_relaxed);
+	}	// Publish PC for the profiler, -1 when execution stops
+	std::atomic<int> * getPublishedPC() {
+		return &sampledPC;
+	}	// Get PC published for the profiler, for engines storing it from host code
+	Tracer * getTracer() const {
+		return tracer;
+	}	// Get execution trace ring buffer
+	const unsigned char * getBreakFlags() const {
+		return &breakFlags[0];
+	}	// Get kinds armed at each memory location, when breakpoints exist
+	const int takeResumePC() {
+		int location = resumePC;
+		resumePC = -1;
+		return location;
+	}	// Get PC of the breakpoint execution resumes from, -1 if none, only once
+	// Record a stop at a breakpoint before pc, or at a watchpoint after the
+	// instruction at pc accessed a location
+	void stopAtBreak(const int& pc, const int& location, const int& kind);
+	// Get offset of the first operand of a kind after the opcode, 0 if none
+	static const int operandOffset(const InstructionInfo& info, const char& kind);
+	// Check if execution must stop at breakpoints, never while replaying
+	const bool isChecked() const {
+		return !breakpoints.empty() && !replaying;
+	}
+	// Prepare recording before executing, restarting it if its history no
+	// longer leads to the current state
+	void beginRecording();
+	// Get instructions to execute until the next periodic checkpoint
+	const unsigned long long untilCheckpoint() const;
+	// Advance recording by instructions executed, taking a checkpoint when
+	// one is due, or before the next execution if it stopped on a signal
+	void advanceRecording(const unsigned long long& executed, const int& signal);
+	// Note a change of memory or PC made outside execution, so recording
+	// takes a checkpoint before executing again
+	void recordEdit();
+
+	// Save registers to a buffer of MAX_REGISTERS bytes, return number saved
+	virtual const int getRegisters(unsigned char * registers) const {
+		return 0;
+	}
+	// Restore registers saved by getRegisters
+	virtual void setRegisters(const unsigned char * registers) {
+	}
+	// Called after the whole memory has been replaced without write hooks
+	virtual void memoryLoaded() {
+	}
 public:
 	const int getPC() const {
 		return pc;
@@ -48,15 +229,163 @@ public:
 	const std::string& getType() const {
 		return type;
 	}	// Get microcontroller type
+	const int getEngine() const {
+		return engine;
+	}	// Get execution engine
+	const bool setEngine(const int& engineInput) {
+		// Only switch to engines supported by this microcontroller
+		if (!supportsEngine(engineInput)) {
+			return false;
+		}
+		engine = engineInput;
+		return true;
+	}	// Set execution engine
+
+	// Check if an execution engine is supported
+	virtual const bool supportsEngine(const int& engineInput) const {
+		return engineInput == INTERPRETER;
+	}
+
+	// Check if execution is counted (always false when compiled out)
+	const bool isInstrumented() const {
+		return MICROCONTROLLER_STATISTICS && instrumented;
+	}
+	// Start or stop counting execution, return false if compiled out
+	const bool setInstrumented(const bool& enabled) {
+		instrumented = enabled;
+		return MICROCONTROLLER_STATISTICS || !enabled;
+	}
+	// Get execution counters
+	const Statistics& getStatistics() const {
+		return statistics;
+	}
+	// Reset execution counters
+	void resetStatistics();
+	// Return execution counters
+	const std::string statisticsString() const;
+	// Describe an opcode, return NULL if it is invalid
+	virtual const InstructionInfo * describeInstruction(const unsigned char& opcode) const = 0;
+	// Get target of the branch at a location, return -1 if it is not a branch
+	const int branchTarget(const int& location) const;
+	// Return instruction at a location in assembler form
+	const std::string disassemble(const int& location) const;
+
+	// Check if the sampling profiler is running
+	const bool isProfiled() const {
+		return profiled;
+	}
+	// Get PC published while executing, -1 if not executing
+	const int getSampledPC() const {
+		return sampledPC.load(std::memory_order_relaxed);
+	}
+	// Start sampling the PC every interval microseconds
+	void startProfiler(const int& interval = 1000);
+	// Stop sampling the PC, keeping the samples
+	void stopProfiler();
+	// Return hottest addresses and loops of the samples
+	const std::string profileString(const int& top = 10) const;
+
+	// Check if executed instructions are recorded
+	const bool isTraced() const {
+		return traced;
+	}
+	// Start recording executed instructions into a new ring buffer keeping
+	// at least capacity records
+	void startTrace(const unsigned int& capacity = 1 << 20);
+	// Stop recording, keeping the records
+	void stopTrace();
+	// Get number of instructions recorded since the trace started
+	const unsigned long long getTraceCount() const;
+	// Write records kept to stream, return false if there is no trace
+	const bool dumpTrace(std::ostream& stream) const;
+
+	// Check if breakpoints or watchpoints exist
+	const bool hasBreakpoints() const {
+		return !breakpoints.empty();
+	}
+	// Get breakpoints and watchpoints, in order of creation
+	const std::vector<Breakpoint>& getBreakpoints() const {
+		return breakpoints;
+	}
+	// Add a breakpoint on PCs or a watchpoint on memory locations from start
+	// to end, return false if the range or kind is invalid
+	const bool addBreakpoint(const int& start, const int& end, const int& kind);
+	// Remove a breakpoint or watchpoint by index, return false if not found
+	const bool removeBreakpoint(const int& index);
+	// Remove all breakpoints and watchpoints
+	void clearBreakpoints();
+	// Return description of the last stop at a breakpoint or watchpoint
+	const std::string breakString() const;
+
+	// Check if execution is recorded for stepping back
+	const bool isRecording() const {
+		return timeline && !replaying;
+	}
+	// Start recording a checkpoint every interval instructions, pages of
+	// checkpoints taking at most limit bytes before the oldest are dropped
+	void startRecording(const unsigned long long& interval = 1 << 16,
+			const size_t& limit = 64 << 20);
+	// Stop recording, dropping the checkpoints
+	void stopRecording();
+	// Get number of instructions executed since recording started
+	const unsigned long long getRecordedTime() const;
+	// Get earliest time execution can go back to
+	const unsigned long long getOldestTime() const;
+	// Get bytes held by checkpoints
+	const size_t getRecordedBytes() const;
+	// Go back to a recorded time, restoring the checkpoint before it and
+	// replaying instructions up to it, return false if not recorded
+	const bool travelTo(const unsigned long long& time);
+	// Go back to the last instruction that wrote a memory location, before
+	// it executes, and set time to its time, return false if none was
+	// recorded, the current state being kept
+	const bool findLastWrite(const int& location, unsigned long long& time);
+
+	// Set rate of frames presented while executing: 0 presents output only
+	// when asked to, negative never presents it (headless)
+	virtual void setFrameRate(const double& rate) {
+	}
+	// Present output written since it was last presented
+	virtual void present() {
+	}
 
 	// Get size of memory
 	virtual const int getMemorySize() const = 0;
+	// Set size of memory, resetting its content, return false if the size
+	// is not supported
+	virtual const bool setMemorySize(const int& size) {
+		return size == getMemorySize();
+	}
 	// Reset microcontroller to initial state
 	virtual void initialize() = 0;
 	// Execute from current PC or from a specific location
 	virtual const int execute(const int& location = -1) = 0;
+	// Execute at most budget instructions from current PC,
+	// budget is decreased by the number of instructions executed
+	virtual const int run(unsigned long long& budget) = 0;
+	// Execute at most budget instructions from current PC or from a specific
+	// location, stopping once a number of seconds has elapsed (no deadline
+	// if seconds is 0)
+	const int runWithDeadline(unsigned long long& budget, const double& seconds,
+			const int& location = -1);
 	// Look at a specific memory location
 	virtual const unsigned char look(const int& location) const = 0;
+	// Return memory rows from start to end as a hexadecimal dump, runs of
+	// all-zero rows collapsing into "*"
+	const std::string dumpMemory(const int& start, const int& end) const;
+	// Search memory for a byte pattern, comparing the bits set in mask (all
+	// bits of bytes mask does not cover), return number of matches and
+	// store the first maximum locations in matches
+	const int searchMemory(const std::vector<unsigned char>& pattern,
+			const std::vector<unsigned char>& mask, std::vector<int>& matches,
+			const int& maximum = 256) const;
+	// Return ranges [start, end) where memory differs from another
+	// microcontroller's, the excess of the larger memory being one range
+	const std::vector<std::pair<int, int> > compareMemory(
+			const Microcontroller& other) const;
+	// Return 64-bit digest of PC, registers and memory, equal for equal
+	// states whichever pages were written
+	const unsigned long long digest() const;
 	// Modify a specify memory location
 	virtual void modify(const int& location, const unsigned char& value) = 0;
 	// Return PC and registers
@@ -65,6 +394,26 @@ public:
 	virtual const std::string getState() const = 0;
 	// Set state from stream
 	virtual const int setState(std::istream& stream) = 0;
+	// Write current state as binary snapshot to stream, or only the pages
+	// written since the last snapshot as a delta chained to it. An untracked
+	// snapshot is a copy later deltas do not chain to
+	const bool getSnapshot(std::ostream& stream, const bool& delta = false,
+			const bool& tracked = true);
+	// Check if there is a snapshot for deltas to chain to
+	const bool hasSnapshot() const {
+		return snapshotId != 0;
+	}
+	// Get number of deltas between current state and its full base snapshot
+	const unsigned int getSnapshotDepth() const {
+		return snapshotDepth;
+	}
+	// Set state from binary snapshot stream, return failure (-1)
+	const int setSnapshot(std::istream& stream);
+	// Check if a stream starts with a binary snapshot
+	static const bool isSnapshot(std::istream& stream);
+	// Set state from binary snapshot or text stream, return failure
+	// (-1 for snapshots, failing line for text)
+	const int loadState(std::istream& stream);
 };
 }
 
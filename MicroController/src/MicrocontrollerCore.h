@@ -0,0 +1,782 @@
+/*
+ * MicrocontrollerCore.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_MICROCONTROLLERCORE_H_
+#define SRC_MICROCONTROLLERCORE_H_
+
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <time.h>
+#include "Microcontroller.h"
+#include "InstructionSet.h"
+#include "Tracer.h"
+
+/* RULES FOR THE INTERPRETER CORE:
+   - A plug-in derives from MicrocontrollerCore<Plugin, memory size> and
+     declares the core and InstructionSet<Plugin> as friends.
+   - The plug-in describes its instructions in InstructionSet<Plugin> (see
+     InstructionSet.h). The core generates from it the interpreter step
+     "const int step(int& pc)", which executes the instruction at pc (always
+     inside memory), moves pc and returns SUCCESS to continue or a signal to
+     stop, the threaded engine, describe(), statusString(), getState() and
+     setState().
+   - execute() and run() call the plug-in's runEngine<BOUNDED>(), which
+     defaults to the interpreter, or the threaded engine if selected. A
+     plug-in with other engines provides its own runEngine() and passes its
+     step methods to interpret<&Plugin::step, BOUNDED>().
+   - The plug-in may provide "void written(const int& location)", called
+     after every write inside memory.
+   - Memory must only be written through write(), or the page written must
+     be flagged PAGE_WRITTEN in getPageFlags() as well, so delta snapshots,
+     clones and recording checkpoints see it.
+   - Instructions must not be longer than 1 + GUARD_SIZE bytes.
+   - Memory size is MEM_SIZE unless set with setMemorySize() when
+     connecting, engines must use getMemorySize().
+   - When instrumented, traced or with breakpoints (isObserved()), the run
+     engine calls interpretObserved<&Plugin::step, BOUNDED>() instead of any
+     other engine, so other engines never check breakpoints. When profiled,
+     the selected engine keeps running and publishes the PC with
+     publishPC() as it goes, then publishes -1 when it stops.
+   - When recording, execute() and run() call runEngine() in slices ending
+     at periodic checkpoints, so every engine can be recorded. Replaying
+     recorded instructions goes through run(), breakpoints being ignored.
+*/
+
+namespace MicrocontrollerEmulation
+{
+	template <class Chip, int SIZE>
+	class MicrocontrollerCore : public Microcontroller
+	{
+	protected:
+		enum {
+			COUNTED = 1, PUBLISHED = 2, TRACED = 4, CHECKED = 8
+		};	// Observers of the interpreter: count instructions, publish PC, record instructions, stop at breakpoints
+		static const int MEM_SIZE = SIZE;	// Default memory size, the smallest supported
+		static const int GUARD_SIZE = 3;	// Zeroed bytes after memory, so operands can be fetched without bounds checks
+
+	private:
+		int memorySize;	// Memory size, MEM_SIZE unless set when connecting
+
+	public:
+		MicrocontrollerCore(const std::string& type) : Microcontroller(type), memorySize(SIZE) {}	// Constructor with type
+
+	protected:
+		// Read memory, locations outside memory read as 0
+		unsigned char read(const int& location) const
+		{
+			return (unsigned int) location < (unsigned int) memorySize ? getMemory()[location] : 0;
+		}
+		// Fetch instruction byte at most GUARD_SIZE bytes after a PC inside memory
+		unsigned char fetch(const int& location) const { return getMemory()[location]; }
+		// Fetch 16-bit big-endian address at most GUARD_SIZE - 1 bytes after a PC inside memory
+		int fetchAddress(const int& location) const
+		{
+			return ((int) getMemory()[location] << 8) | getMemory()[location + 1];
+		}
+		// Write memory and mark its page dirty, locations outside memory are ignored
+		void write(const int& location, const unsigned char& value)
+		{
+			if ((unsigned int) location < (unsigned int) memorySize)
+			{
+				getMemory()[location] = value;
+				markDirty(location);
+				static_cast<Chip *>(this)->written(location);
+			}
+		}
+		// Called after every write inside memory
+		void written(const int& location) {}
+
+		// Allocate memory or re-initialize it to 0, all pages being dirty
+		void initializeMemory()
+		{
+			// Guard bytes are never written, so they stay 0
+			if (!getMemory())
+			{
+				markAllDirty();
+				allocateMemory(memorySize + GUARD_SIZE);
+			}
+			else
+			{
+				clearMemory();
+			}
+		}
+
+		// Describe an opcode from the decode table, return NULL if it is invalid
+		static const InstructionInfo * describe(const unsigned char& opcode)
+		{
+			typedef InstructionSet<Chip> Set;
+			return Set::TABLE.valid[opcode] ? &Set::TABLE.info[opcode] : NULL;
+		}
+
+		// Execute instruction of a known opcode at PC, its handler being
+		// resolved at compile time so it can be inlined
+		template <int OPCODE>
+		const int stepOpcode(int& pc)
+		{
+			typedef InstructionSet<Chip> Set;
+			if constexpr (!Set::TABLE.valid[OPCODE])
+			{
+				// If invalid opcode found, return SIGOP signal
+				return SIGOP;
+			}
+			else
+			{
+				// Preset next instruction, then move PC only if the
+				// instruction completed
+				int next = pc + Set::TABLE.info[OPCODE].length;
+				int signal = (static_cast<Chip&>(*this).*Set::TABLE.execute[OPCODE])(pc, next);
+				if (signal == SUCCESS)
+				{
+					pc = next;
+				}
+				return signal;
+			}
+		}
+
+		// Execute instruction at PC, dispatching on its opcode
+		const int step(int& pc)
+		{
+			switch (fetch(pc))
+			{
+#define CASE(opcode) case opcode: return stepOpcode<opcode>(pc);
+				INSTRUCTION_SET_OPCODES(CASE)
+#undef CASE
+			}
+			return SIGOP;
+		}
+
+		// Execute from current PC using threaded-code dispatch, jumping
+		// straight from each instruction to the label of the next opcode
+		// (observers are 0 or PUBLISHED, PC being published for the profiler
+		// before every instruction)
+		template <bool BOUNDED, int OBSERVERS = 0>
+		const int executeThreaded(unsigned long long& budget)
+		{
+			typedef InstructionSet<Chip> Set;
+			Chip& chip = static_cast<Chip&>(*this);
+
+			// Label of every opcode
+#define LABEL(opcode) &&label##opcode,
+			static void * const labels[256] = {INSTRUCTION_SET_OPCODES(LABEL)};
+#undef LABEL
+
+			// Check PC and budget, and jump to the label of the next opcode
+			// (the budget is charged before the instruction runs)
+#define DISPATCH() \
+			if ((unsigned int) pc >= size) goto outsideMemory; \
+			if (BOUNDED && !left--) goto budgetExhausted; \
+			goto *labels[memory[pc]]
+
+			// Keep PC, memory and budget local while running
+			const unsigned char * memory = getMemory();
+			const unsigned int size = memorySize;
+			int pc = getPC(), next, signal;
+			unsigned long long left = budget;
+
+			// Start executing
+			DISPATCH();
+
+			// Execute handler of each listed opcode, stopping if it raises a signal
+#define EXECUTE(opcode) \
+		label##opcode: \
+			if constexpr (!Set::TABLE.valid[opcode]) goto invalidOpcode; \
+			else \
+			{ \
+				if (OBSERVERS & PUBLISHED) publishPC(pc); \
+				next = pc + Set::TABLE.info[opcode].length; \
+				if ((signal = (chip.*Set::TABLE.execute[opcode])(pc, next)) != SUCCESS) goto stopped; \
+				pc = next; \
+				DISPATCH(); \
+			}
+			INSTRUCTION_SET_OPCODES(EXECUTE)
+#undef EXECUTE
+
+		invalidOpcode:
+			// If invalid opcode found, return SIGOP signal
+			signal = SIGOP;
+
+		stopped:
+			// A halted or invalid instruction does not count as executed
+			setPC(pc);
+			if (BOUNDED)
+			{
+				budget = left + 1;
+			}
+			return signal;
+
+		outsideMemory:
+			// If PC go outside memory, return SIGWEED signal
+			// (a negative PC reads as an invalid opcode)
+			setPC(pc);
+			if (BOUNDED)
+			{
+				budget = left;
+			}
+			return pc < 0 ? SIGOP : SIGWEED;
+
+		budgetExhausted:
+			// If budget is used up, stop at the next instruction
+			setPC(pc);
+			if (BOUNDED)
+			{
+				budget = 0;
+			}
+			return BUDGET_EXHAUSTED;
+#undef DISPATCH
+		}
+
+		// Execute from current PC with the selected engine: the interpreter
+		// with observers if observed, else the threaded engine if selected,
+		// else the interpreter, both publishing the PC if profiled
+		template <bool BOUNDED>
+		const int runEngine(unsigned long long& budget)
+		{
+			if (isObserved())
+			{
+				return interpretObserved<&MicrocontrollerCore::step, BOUNDED>(budget);
+			}
+			if (isProfiled())
+			{
+				int signal = getEngine() == THREADED ? executeThreaded<BOUNDED, PUBLISHED>(budget)
+						: interpret<&MicrocontrollerCore::step, BOUNDED, PUBLISHED>(budget);
+				publishPC(-1);
+				return signal;
+			}
+			return getEngine() == THREADED ? executeThreaded<BOUNDED>(budget)
+					: interpret<&MicrocontrollerCore::step, BOUNDED>(budget);
+		}
+
+		// Execute from current PC with a step method until a signal is raised,
+		// or, if bounded, until budget instructions have been executed
+		// (observers are a mask of COUNTED, every retired instruction and branch
+		// outcome being counted, PUBLISHED, PC being published for the profiler
+		// before every step, TRACED, every instruction being recorded, and
+		// CHECKED, execution stopping before a breakpoint and after an access
+		// to a watched location)
+		template <auto STEP, bool BOUNDED, int OBSERVERS = 0>
+		const int interpret(unsigned long long& budget)
+		{
+			Chip& chip = static_cast<Chip&>(*this);
+			const unsigned int size = memorySize;
+			int pc = getPC();
+			int signal;
+
+			// Breakpoint execution resumes from, passed once
+			int resume = OBSERVERS & CHECKED ? takeResumePC() : -1;
+
+			// Step through instructions while PC stays inside memory
+			while ((unsigned int) pc < size)
+			{
+				// If budget is used up, stop at the next instruction
+				if (BOUNDED && !budget)
+				{
+					setPC(pc);
+					return BUDGET_EXHAUSTED;
+				}
+
+				// Stop before a breakpoint, and find watched location the
+				// instruction accesses
+				int watched = -1, access = 0;
+				if (OBSERVERS & CHECKED)
+				{
+					if ((getBreakFlags()[pc] & BREAKPOINT) && pc != resume)
+					{
+						stopAtBreak(pc, pc, BREAKPOINT);
+						setPC(pc);
+						return BREAK;
+					}
+					resume = -1;
+					watched = watchedAccess(pc, access);
+				}
+
+				if (OBSERVERS & PUBLISHED)
+				{
+					publishPC(pc);
+				}
+
+				// Record instruction before it runs, as it may overwrite itself
+				TraceRecord * record = NULL;
+				if (OBSERVERS & TRACED)
+				{
+					record = &getTracer()->next();
+					record->pc = pc;
+					record->opcode = fetch(pc);
+					record->operands[0] = fetch(pc + 1);
+					record->operands[1] = fetch(pc + 2);
+					record->operands[2] = fetch(pc + 3);
+				}
+
+				// Step a copy of PC, which keeps PC in a register across the
+				// publishing store
+				int from = pc, next = pc;
+				signal = (chip.*STEP)(next);
+				pc = next;
+
+				if (OBSERVERS & TRACED)
+				{
+					trace(*record, signal);
+				}
+
+				if (signal != SUCCESS)
+				{
+					setPC(pc);
+					return signal;
+				}
+
+				if (OBSERVERS & COUNTED)
+				{
+					count(from, pc);
+				}
+
+				if (BOUNDED)
+				{
+					budget--;
+				}
+
+				// Stop after an access to a watched location
+				if ((OBSERVERS & CHECKED) && watched >= 0)
+				{
+					stopAtBreak(from, watched, access);
+					setPC(pc);
+					return BREAK;
+				}
+			}
+
+			// If PC go outside memory, return SIGWEED signal
+			// (a negative PC reads as an invalid opcode)
+			setPC(pc);
+			return pc < 0 ? SIGOP : SIGWEED;
+		}
+
+		// Count a retired instruction, a branch being taken if it did not
+		// fall through to the next instruction
+		void count(const int& from, const int& to)
+		{
+			unsigned char opcode = fetch(from);
+			statistics.instructions++;
+			statistics.opcodes[opcode]++;
+
+			const InstructionInfo * info = describe(opcode);
+			if (info && info->branch)
+			{
+				if (to != from + info->length)
+				{
+					statistics.taken++;
+				}
+				else
+				{
+					statistics.notTaken++;
+				}
+			}
+		}
+
+		// Complete record of an executed instruction with register W and the
+		// memory location written, taken from the opcode description
+		void trace(TraceRecord& record, const int& signal)
+		{
+			unsigned char registers[MAX_REGISTERS];
+			record.registerW = static_cast<Chip&>(*this).Chip::getRegisters(registers) ? registers[0] : 0;
+			record.signal = signal;
+			record.reserved = 0;
+			record.address = -1;
+			record.value = 0;
+
+			const InstructionInfo * info = describe(record.opcode);
+			int offset;
+			if (info && info->writes && (offset = operandOffset(*info, 'a')))
+			{
+				record.address = ((int) record.operands[offset - 1] << 8) | record.operands[offset];
+				record.value = read(record.address);
+			}
+		}
+
+		// Get location of a watched memory access of the instruction at pc,
+		// taken from the opcode description, and the kinds of access watched,
+		// return -1 if it accesses no watched location
+		const int watchedAccess(const int& pc, int& access) const
+		{
+			const InstructionInfo * info = describe(fetch(pc));
+			int offset;
+			if (!info || !(info->reads || info->writes)
+					|| !(offset = operandOffset(*info, 'a')))
+			{
+				return -1;
+			}
+
+			int location = fetchAddress(pc + offset);
+			if ((unsigned int) location >= (unsigned int) memorySize)
+			{
+				return -1;
+			}
+			access = getBreakFlags()[location] & ((info->reads ? WATCH_READ : 0)
+					| (info->writes ? WATCH_WRITE : 0));
+			return access ? location : -1;
+		}
+
+		// Check if execution must go through interpretObserved()
+		const bool isObserved() const
+		{
+			return isInstrumented() || isTraced() || isChecked();
+		}
+
+		// Execute from current PC with the interpreter instantiated for a mask
+		// of observers, in addition to the CHECKED observer if given
+		template <auto STEP, bool BOUNDED, int CHECKS>
+		const int interpretWith(unsigned long long& budget, const int& observers)
+		{
+			switch (observers)
+			{
+				case 0:
+					return interpret<STEP, BOUNDED, CHECKS>(budget);
+				case COUNTED:
+					return interpret<STEP, BOUNDED, CHECKS | COUNTED>(budget);
+				case PUBLISHED:
+					return interpret<STEP, BOUNDED, CHECKS | PUBLISHED>(budget);
+				case COUNTED | PUBLISHED:
+					return interpret<STEP, BOUNDED, CHECKS | COUNTED | PUBLISHED>(budget);
+				case TRACED:
+					return interpret<STEP, BOUNDED, CHECKS | TRACED>(budget);
+				case COUNTED | TRACED:
+					return interpret<STEP, BOUNDED, CHECKS | COUNTED | TRACED>(budget);
+				case PUBLISHED | TRACED:
+					return interpret<STEP, BOUNDED, CHECKS | PUBLISHED | TRACED>(budget);
+				default:
+					return interpret<STEP, BOUNDED, CHECKS | COUNTED | PUBLISHED | TRACED>(budget);
+			}
+		}
+
+		// Execute from current PC with the interpreter and the observers
+		// enabled, timing the call if instrumented
+		template <auto STEP, bool BOUNDED>
+		const int interpretObserved(unsigned long long& budget)
+		{
+			int signal;
+			struct timespec start, end;
+			if (isInstrumented())
+			{
+				clock_gettime(CLOCK_MONOTONIC, &start);
+			}
+
+			// Select interpreter instantiation of the observers
+			int observers = (isInstrumented() ? COUNTED : 0) | (isProfiled() ? PUBLISHED : 0)
+					| (isTraced() ? TRACED : 0);
+			signal = isChecked() ? interpretWith<STEP, BOUNDED, CHECKED>(budget, observers)
+					: interpretWith<STEP, BOUNDED, 0>(budget, observers);
+			publishPC(-1);
+
+			if (!isInstrumented())
+			{
+				return signal;
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			statistics.calls++;
+			statistics.lastSeconds = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) * 1e-9;
+			statistics.seconds += statistics.lastSeconds;
+
+			return signal;
+		}
+
+		// Execute from current PC with the selected engine while recording,
+		// in slices ending at periodic checkpoints, or, if bounded, until
+		// budget instructions have been executed
+		template <bool BOUNDED>
+		const int runRecorded(unsigned long long& budget)
+		{
+			beginRecording();
+			while (true)
+			{
+				// Run up to the next checkpoint or the end of the budget
+				unsigned long long slice = untilCheckpoint();
+				if (BOUNDED)
+				{
+					slice = std::min(slice, budget);
+				}
+				unsigned long long left = slice;
+				int signal = static_cast<Chip&>(*this).template runEngine<true>(left);
+				advanceRecording(slice - left, signal);
+				if (BOUNDED)
+				{
+					budget -= slice - left;
+				}
+
+				// Stop on any other signal or at the end of the budget
+				if (signal != BUDGET_EXHAUSTED || (BOUNDED && !budget))
+				{
+					return signal;
+				}
+			}
+		}
+
+	public:
+		const int getMemorySize() const { return memorySize; }	// Get size of memory
+
+		// Set size of memory between MEM_SIZE and MAX_MEMORY_SIZE, resetting
+		// its content, return false if the size is not supported
+		const bool setMemorySize(const int& size)
+		{
+			if (size < SIZE || size > MAX_MEMORY_SIZE)
+			{
+				return false;
+			}
+			if (size != memorySize)
+			{
+				clearBreakpoints();
+				releaseMemory();
+				memorySize = size;
+				initializeMemory();
+				memoryLoaded();
+			}
+			return true;
+		}
+		const InstructionInfo * describeInstruction(const unsigned char& opcode) const { return describe(opcode); }	// Describe an opcode, return NULL if it is invalid
+		const unsigned char look(const int& location) const { return read(location); }	// Look at a specific memory location
+
+		// Modify a specific memory location
+		void modify(const int& location, const unsigned char& value)
+		{
+			write(location, value);
+			recordEdit();
+		}
+
+		// Check if an execution engine is supported
+		const bool supportsEngine(const int& engine) const
+		{
+			return engine == INTERPRETER || engine == THREADED;
+		}
+
+		// Execute from current PC or from a specific location
+		const int execute(const int& location = -1)
+		{
+			// If location is provided, set pc to that
+			if (location != -1)
+			{
+				setPC(location);
+				recordEdit();
+			}
+
+			// Run until a signal is raised
+			unsigned long long budget = 0;
+			return isRecording() ? runRecorded<false>(budget)
+					: static_cast<Chip&>(*this).template runEngine<false>(budget);
+		}
+
+		// Execute at most budget instructions from current PC
+		const int run(unsigned long long& budget)
+		{
+			return isRecording() ? runRecorded<true>(budget)
+					: static_cast<Chip&>(*this).template runEngine<true>(budget);
+		}
+
+		// Return PC and registers named by the instruction set
+		const std::string statusString() const
+		{
+			unsigned char registers[MAX_REGISTERS];
+			static_cast<const Chip&>(*this).Chip::getRegisters(registers);
+
+			// Add status to string stream
+			std::ostringstream stream;
+			stream << "Status:\n"
+				   << " - PC: 0x"
+				   << std::hex << std::setw(3) << std::setfill('0')
+				   << getPC() << '\n';
+			for (int i = 0; InstructionSet<Chip>::REGISTERS[i]; i++)
+			{
+				stream << " - Register " << InstructionSet<Chip>::REGISTERS[i] << ": 0x"
+					   << std::hex << std::setw(2) << std::setfill('0')
+					   << (int) registers[i] << '\n';
+			}
+			if (memorySize != SIZE)
+			{
+				stream << " - Memory: 0x" << std::hex << memorySize << " bytes\n";
+			}
+
+			// Add execution counters if instrumented or counted before
+			if (isInstrumented() || getStatistics().calls)
+			{
+				stream << statisticsString();
+			}
+
+			// Return status string
+			return stream.str();
+		}
+
+		// Get current state: PC, registers named by the instruction set and
+		// non-zero memory locations, one "name=value" per line
+		const std::string getState() const
+		{
+			unsigned char registers[MAX_REGISTERS];
+			static_cast<const Chip&>(*this).Chip::getRegisters(registers);
+
+			// Add PC and registers to output
+			std::ostringstream sstream;
+			sstream << "PC=" << getPC() << '\n';
+			for (int i = 0; InstructionSet<Chip>::REGISTERS[i]; i++)
+			{
+				sstream << InstructionSet<Chip>::REGISTERS[i] << '=' << (int) registers[i] << '\n';
+			}
+
+			// Loop through pages written since reset to save non-zero
+			// values, other pages being 0
+			const unsigned char * flags = getPageFlags();
+			for (int i = 0; i < memorySize; i++)
+			{
+				if (!(flags[i >> PAGE_SHIFT] & PAGE_TOUCHED))
+				{
+					i |= (1 << PAGE_SHIFT) - 1;
+				}
+				else if (getMemory()[i])
+				{
+					sstream << i << '=' << (int) getMemory()[i] << '\n';
+				}
+			}
+
+			// Return state string
+			return sstream.str();
+		}
+
+		// Set state from stream, return index of the first invalid line, or
+		// 0 on success. The stream is read in chunks and parsed in place,
+		// memory is written without write hooks and memoryLoaded() is called
+		// once at the end
+		const int setState(std::istream& stream)
+		{
+			Chip& chip = static_cast<Chip&>(*this);
+			unsigned char registers[MAX_REGISTERS];
+			chip.Chip::getRegisters(registers);
+
+			// Buffer of chunks read, an incomplete line is kept at its start
+			char buffer[1 << 16];
+			size_t kept = 0;
+			bool loaded = false, more = true;
+			int index = 0, failure = 0;
+
+			// Parse each complete line, and the last one at end of stream
+			while (more && !failure)
+			{
+				stream.read(buffer + kept, sizeof(buffer) - kept);
+				more = stream.gcount() > 0;
+				const char * position = buffer, * end = buffer + kept + stream.gcount();
+				while (position < end)
+				{
+					const char * newline = (const char *) memchr(position, '\n', end - position);
+					if (!newline && more)
+					{
+						break;
+					}
+
+					index++;
+					if (!parseStateLine(position, newline ? newline : end, registers, loaded))
+					{
+						failure = index;
+						break;
+					}
+					position = newline ? newline + 1 : end;
+				}
+
+				// Keep incomplete line, a line longer than the buffer is invalid
+				kept = end - position;
+				if (kept == sizeof(buffer))
+				{
+					failure = index + 1;
+				}
+				memmove(buffer, position, kept);
+			}
+
+			// Apply registers and let the plug-in see the new memory
+			chip.Chip::setRegisters(registers);
+			if (loaded)
+			{
+				memoryLoaded();
+			}
+
+			// Return failure (line index) or success (0)
+			return failure;
+		}
+
+	private:
+		// Parse a decimal number after optional blanks, return the position
+		// after it, or NULL if there is none
+		static const char * parseNumber(const char * position, const char * end, int& value)
+		{
+			while (position < end && (*position == ' ' || *position == '\t'))
+			{
+				position++;
+			}
+			if (position < end && *position == '+')
+			{
+				position++;
+			}
+			std::from_chars_result result = std::from_chars(position, end, value);
+			return result.ec == std::errc() ? result.ptr : NULL;
+		}
+
+		// Apply a "PC=value", "register=value" or "location=value" line of
+		// the text state, return false if it is invalid
+		const bool parseStateLine(const char * line, const char * end,
+				unsigned char * registers, bool& loaded)
+		{
+			// Find name before '='
+			const char * equals = (const char *) memchr(line, '=', end - line);
+			size_t length = (equals ? equals : end) - line;
+			int value;
+
+			// Modify PC
+			if (length == 2 && line[0] == 'P' && line[1] == 'C')
+			{
+				if (!equals || !parseNumber(equals + 1, end, value))
+				{
+					return false;
+				}
+				setPC(value);
+				return true;
+			}
+
+			// Modify a register named by the instruction set
+			for (int i = 0; InstructionSet<Chip>::REGISTERS[i]; i++)
+			{
+				const char * name = InstructionSet<Chip>::REGISTERS[i];
+				if (length == strlen(name) && !memcmp(line, name, length))
+				{
+					if (!equals || !parseNumber(equals + 1, end, value))
+					{
+						return false;
+					}
+					registers[i] = value;
+					return true;
+				}
+			}
+
+			// Else, modify memory content, locations outside memory are ignored
+			int location;
+			const char * position = parseNumber(line, end, location);
+			if (!position || position == end || !parseNumber(position + 1, end, value))
+			{
+				return false;
+			}
+			if ((unsigned int) location < (unsigned int) memorySize)
+			{
+				getMemory()[location] = value;
+				markDirty(location);
+				loaded = true;
+			}
+			return true;
+		}
+	};
+
+	// Define memory size and guard size, so they can be bound to references
+	template <class Chip, int SIZE> const int MicrocontrollerCore<Chip, SIZE>::MEM_SIZE;
+	template <class Chip, int SIZE> const int MicrocontrollerCore<Chip, SIZE>::GUARD_SIZE;
+}
+
+
+
+#endif /* SRC_MICROCONTROLLERCORE_H_ */
@@ -6,8 +6,13 @@
  */
 
 #include <string>
+#include <iostream>
+#include <algorithm>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <cstdlib>
 #include "MicrocontrollerFactory.h"
-#include "Mops.h"
 
 /* RULES FOR NEW MICROCONTROLLER PLUG-INS:
    - New microcontroller classes must extend "Microcontroller" base class
@@ -15,44 +20,154 @@
    - Memory size Get method must be public.
    - There must be a constructor with parameter "type" (in string format)
      that call the corresponding parameterized base class constructor.
+   - Registers must be exposed through getRegisters()/setRegisters(), so
+     snapshots and clones carry them.
+   - The plug-in source file registers its type with a static
+     MicrocontrollerFactory::Registration<Plugin> instance. Built in
+     plug-ins register before main() runs.
+   - A plug-in built as a shared object (g++ -shared -fPIC) and dropped in
+     the plug-in directory registers when it is loaded at startup. The
+     emulator must be linked with -rdynamic, so the module sees its
+     classes.
+*/
+
+/* TYPES NOT EMULATED:
+   - 34HC22 (Rotamola): no specification of its instruction set is
+     available, so it has no plug-in and its type is not registered.
+     Requests to emulate it go back until a specification comes with them.
 */
 
 namespace MicrocontrollerEmulation
 {
-	// Types of microcontroller
-	// Please append type names here after adding new plug-ins
-	const std::string MicrocontrollerFactory::TYPES[] = {"R500", "PIC32F42", "34HC22"};
+	// Default plug-in directory, next to the executable, and the environment
+	// variable overriding it
+	const char * const MicrocontrollerFactory::PLUGIN_DIRECTORY = "plugins";
+	const char * const MicrocontrollerFactory::PLUGIN_VARIABLE = "MICROCONTROLLER_PLUGINS";
 
-	// Get number of microcontroller types
-	const int MicrocontrollerFactory::numberOfTypes ()
+	// Get registry, created on first use so plug-ins can register from
+	// any static initializer
+	MicrocontrollerFactory::Registry& MicrocontrollerFactory::getRegistry ()
 	{
-		return sizeof(TYPES) / sizeof(std::string);
+		static Registry registry;
+		return registry;
 	}
 
-	// Create microcontroller of specified type
-	// Add check conditions for pluged-in types here
-	Microcontroller * MicrocontrollerFactory::createMicrocontroller (const std::string& type) const
+	// Register a plug-in type, return false if it is already registered
+	const bool MicrocontrollerFactory::registerType (const std::string& type, const Creator& creator)
+	{
+		Registry& registry = getRegistry();
+		if (!registry.creators.insert(std::make_pair(type, creator)).second)
+		{
+			std::cerr << "Microcontroller type " << type << " is already registered" << std::endl;
+			return false;
+		}
+
+		// Keep types listed in alphabetical order, whatever the order of
+		// registration
+		registry.types.insert(std::upper_bound(registry.types.begin(), registry.types.end(), type), type);
+		return true;
+	}
+
+	// Get plug-in directory, the environment variable if set, else the
+	// default one next to the executable, empty if it cannot be found
+	const std::string MicrocontrollerFactory::getPluginDirectory ()
+	{
+		const char * variable = getenv(PLUGIN_VARIABLE);
+		if (variable)
+		{
+			return variable;
+		}
+
+		// Resolve the executable, so the default does not depend on the
+		// working directory
+		char executable[4096];
+		ssize_t length = readlink("/proc/self/exe", executable, sizeof(executable) - 1);
+		if (length <= 0)
+		{
+			return "";
+		}
+		std::string path(executable, length);
+		return path.substr(0, path.rfind('/') + 1) + PLUGIN_DIRECTORY;
+	}
+
+	// Load plug-in modules (*.so) of a directory, return number loaded
+	const int MicrocontrollerFactory::loadPlugins (const std::string& directory)
 	{
-		// Check for type R500 (Mops)
-		if (type == TYPES[0])
+		// An unknown or missing directory has no plug-ins
+		if (directory.empty())
 		{
-			return new Mops(type);
+			return 0;
+		}
+		DIR * folder = opendir(directory.c_str());
+		if (!folder)
+		{
+			return 0;
 		}
 
-		// Check for type PIC32F42 (Macrochip)
-		if (type == TYPES[1])
+		// Load every shared object, its static registrations run on load.
+		// Modules stay loaded, as their microcontrollers may live until exit
+		int loaded = 0;
+		struct dirent * entry;
+		while ((entry = readdir(folder)))
 		{
-			return new Macrochip(type);
+			std::string name = entry->d_name;
+			if (name.size() <= 3 || name.compare(name.size() - 3, 3, ".so"))
+			{
+				continue;
+			}
+
+			std::string path = directory + '/' + name;
+			if (dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL))
+			{
+				loaded++;
+			}
+			else
+			{
+				std::cerr << "Cannot load plug-in " << path << ": " << dlerror() << std::endl;
+			}
 		}
+		closedir(folder);
+
+		return loaded;
+	}
+
+	// Get registered microcontroller types
+	const std::vector<std::string>& MicrocontrollerFactory::getTypes ()
+	{
+		return getRegistry().types;
+	}
+
+	// Get number of microcontroller types
+	const int MicrocontrollerFactory::numberOfTypes ()
+	{
+		return getRegistry().types.size();
+	}
+
+	// Create microcontroller of specified type, return NULL if it is not
+	// registered
+	Microcontroller * MicrocontrollerFactory::createMicrocontroller (const std::string& type) const
+	{
+		const Registry& registry = getRegistry();
+		std::unordered_map<std::string, Creator>::const_iterator found = registry.creators.find(type);
+		return found != registry.creators.end() ? found->second(type) : NULL;
+	}
+
+	// Create independent copy of a microcontroller
+	Microcontroller * MicrocontrollerFactory::cloneMicrocontroller (const Microcontroller * source) const
+	{
+		// Create reset microcontroller of the same type
+		Microcontroller * microcontroller = createMicrocontroller(source->getType());
 
-		// Check for type 34HC22 (Rotamola)
-		if (type == TYPES[2])
+		// Copy memory size, PC, registers, engine and only the pages the
+		// source has written
+		if (microcontroller)
 		{
-			return NULL;
-			//return new Rotamola(type);
+			microcontroller->setMemorySize(source->getMemorySize());
+			microcontroller->initialize();
+			microcontroller->copyFrom(*source);
 		}
 
-		return NULL;
+		return microcontroller;
 	}
 }
 
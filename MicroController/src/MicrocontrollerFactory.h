@@ -9,7 +9,8 @@
 #define SRC_MICROCONTROLLERFACTORY_H_
 
 #include <string>
-#include <map>
+#include <vector>
+#include <unordered_map>
 #include "Microcontroller.h"
 
 namespace MicrocontrollerEmulation
@@ -17,13 +18,47 @@ namespace MicrocontrollerEmulation
 	class MicrocontrollerFactory
 	{
 	public:
-		static const std::string TYPES[];	// Types of microcontroller
+		typedef Microcontroller * (*Creator)(const std::string& type);	// Creator of a plug-in with its type
+		static const char * const PLUGIN_DIRECTORY;	// Default directory of plug-in modules, next to the executable
+		static const char * const PLUGIN_VARIABLE;	// Environment variable overriding the plug-in directory
+
+		// Registers a plug-in class under a type when constructed, plug-ins
+		// define one static instance in their source file
+		template <class Plugin>
+		class Registration
+		{
+		public:
+			Registration(const std::string& type) { registerType(type, &create); }	// Constructor with type
+
+		private:
+			static Microcontroller * create(const std::string& type) { return new Plugin(type); }	// Create plug-in
+		};
+
+	private:
+		// Plug-ins registered at startup, by type
+		struct Registry
+		{
+			std::unordered_map<std::string, Creator> creators;	// Creator of each type
+			std::vector<std::string> types;	// Types in alphabetical order
+		};
+		static Registry& getRegistry();	// Get registry, created on first use
 
 	public:
+		// Register a plug-in type, return false if it is already registered
+		static const bool registerType(const std::string& type, const Creator& creator);
+		// Get plug-in directory, the environment variable if set, else the
+		// default one next to the executable, empty if it cannot be found
+		static const std::string getPluginDirectory();
+		// Load plug-in modules (*.so) of a directory, return number loaded
+		static const int loadPlugins(const std::string& directory);
+		// Get registered microcontroller types
+		static const std::vector<std::string>& getTypes();
 		// Get number of microcontroller types
 		static const int numberOfTypes();
 		// Create microcontroller of specified type
 		Microcontroller * createMicrocontroller(const std::string& type) const;
+		// Create independent copy of a microcontroller
+		Microcontroller * cloneMicrocontroller(const Microcontroller * source) const;
 	};
 }
 
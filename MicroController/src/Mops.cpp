@@ -7,15 +7,20 @@
 
 #include <algorithm>
 #include <string>
-#include <sstream>
-#include <iomanip>
 #include <iostream>
 #include "Mops.h"
+#include "MicrocontrollerFactory.h"
 
 namespace MicrocontrollerEmulation
 {
-	// Initialize initial PC and memory size value
-	const int Mops::PC = 0, Mops::MEM_SIZE = 1024;
+	// Register type R500
+	static const MicrocontrollerFactory::Registration<Mops> REGISTRATION("R500");
+
+	// Initialize initial PC value
+	const int Mops::PC = 0;
+
+	// Instructions interpreted at once where no block can be run
+	static const unsigned long long INTERPRET_SLICE = 64;
 
 	// Reset microcontroller to initial state
 	void Mops::initialize ()
@@ -23,233 +28,156 @@ namespace MicrocontrollerEmulation
 		// Reset PC to initial value
 		setPC(PC);
 
-		// If memory is not allocated, do allocation
-		if (!getMemory())
-		{
-			setMemory(new unsigned char[MEM_SIZE]());
-		}
-		else
-		{
-			// Else, re-initialize memory to 0
-			std::fill_n(getMemory(), MEM_SIZE, 0);
-		}
+		// Allocate memory or re-initialize it to 0
+		initializeMemory();
+
+		// Drop host code of the previous program
+		memoryLoaded();
 	}
 
-	// Execute from current PC or from a specific location
-	const int Mops::execute (const int& location)
+	// Drop host code after memory is replaced, and the translator if
+	// memory was resized
+	void Mops::memoryLoaded ()
 	{
-		// If location is provided, set pc to that
-		if (location != -1)
+		if (compiler && compiler->getMemorySize() != getMemorySize())
 		{
-			setPC(location);
+			delete compiler;
+			compiler = NULL;
 		}
-
-		// Execute program until halt opcode found
-		while (look(getPC()) != 0xFF)
+		else if (compiler)
 		{
-			// Get current PC and opcode
-			int pc = getPC();
-			unsigned char opcode = look(getPC());
-
-			// If PC go outside memory, return SIGWEED opcode
-			if (pc >= MEM_SIZE)
-			{
-				return Microcontroller::SIGWEED;
-			}
-
-			// Temporary value and memory address
-			int address;
-			unsigned char value;
-
-			// Fetch, Decode and Execute instruction
-			switch (opcode)
-			{
-				case 0x0A:
-					// Add value to memory
-
-					// Get target memory location
-					address = ((int) look(pc + 2) << 8) | look(pc + 3);
-
-					// Get and add value to target
-					value = look(address) + look(pc + 1);
-
-					// Modify memory content
-					modify(address, value);
-
-					// Update PC
-					setPC(pc + 4);
-					break;
-				case 0x13:
-					// Subtract value from memory
-
-					// Get target memory location
-					address = ((int) look(pc + 2) << 8) | look(pc + 3);
-
-					// Get and add value to target
-					value = look(address) - look(pc + 1);
-
-					// Modify memory content
-					modify(address, value);
-
-					// Update PC
-					setPC(pc + 4);
-					break;
-				case 0x16:
-					// Go to address
-
-					// Get target memory location
-					address = ((int) look(pc + 1) << 8) | look(pc + 2);
-
-					// Update PC
-					setPC(address);
-					break;
-				case 0x17:
-					// Branch relative
-
-					// Get offset value
-					value = look(pc + 1);
-
-					// Update PC
-					setPC(pc + (int)((char) value));
-					break;
-				default:
-					// If invalid opcode found, return SIGOP signal
-					return Microcontroller::SIGOP;
-					break;
-			}
+			compiler->flush();
 		}
-
-		// If halt opcode catch, return HALT signal
-		return Microcontroller::HALT;
 	}
 
-	// Look at a specific memory location
-	const unsigned char Mops::look (const int& location) const
+	// Check if an execution engine is supported
+	const bool Mops::supportsEngine (const int& engine) const
 	{
-		// If location input is outside memory, return 0
-		if (location < 0 || location >= MEM_SIZE)
-		{
-			return 0;
-		}
-
-		// Else, return memory content
-		return getMemory()[location];
+		return (engine == JIT && MopsCompiler::isSupported())
+				|| MicrocontrollerCore<Mops, 1024>::supportsEngine(engine);
 	}
 
-	// Modify a specific memory location
-	void Mops::modify (const int& location, const unsigned char& value)
+	// Add value to memory
+	const int Mops::add (const int& pc, int& next)
 	{
-		// If location input is valid, modify memory content
-		if (location >= 0 && location < MEM_SIZE)
-		{
-			getMemory()[location] = value;
-		}
+		int address = fetchAddress(pc + 2);
+		write(address, read(address) + fetch(pc + 1));
+		return Microcontroller::SUCCESS;
 	}
 
-	// Return PC and registers
-	const std::string Mops::statusString () const
+	// Subtract value from memory
+	const int Mops::subtract (const int& pc, int& next)
 	{
-		// Create output string stream
-		std::ostringstream stream;
-
-		// Add status to string stream
-		stream << "Status:\n"
-			   << " - PC: 0x"
-			   << std::hex << std::setw(3) << std::setfill('0')
-			   << getPC() << std::endl;
+		int address = fetchAddress(pc + 2);
+		write(address, read(address) - fetch(pc + 1));
+		return Microcontroller::SUCCESS;
+	}
 
-		// Return status string
-		return stream.str();
+	// Go to address
+	const int Mops::jump (const int& pc, int& next)
+	{
+		next = fetchAddress(pc + 1);
+		return Microcontroller::SUCCESS;
 	}
 
-	// Get current state
-	const std::string Mops::getState () const
+	// Branch relative, the offset counting from the branch itself
+	const int Mops::branch (const int& pc, int& next)
 	{
-		// Create output string stream
-		std::ostringstream sstream;
+		next = pc + (int)((char) fetch(pc + 1));
+		return Microcontroller::SUCCESS;
+	}
 
-		// Add PC to output
-		sstream << "PC=" << getPC() << std::endl;
+	// Raise HALT
+	const int Mops::halt (const int& pc, int& next)
+	{
+		return Microcontroller::HALT;
+	}
 
-		// Loop through memory to save non-zero values
-		for (int i = 0; i < MEM_SIZE; i++)
+	// Keep host code in sync with a write
+	inline void Mops::written (const int& location)
+	{
+		if (compiler)
 		{
-			// Get current value
-			unsigned char value = look(i);
-
-			// If value is non-zero, save to output
-			if (value)
-			{
-				sstream << i << '=' << (int) value << std::endl;
-			}
+			compiler->invalidate(location);
 		}
-
-		// Return state string
-		return sstream.str();
 	}
 
-	// Set state from stream
-	const int Mops::setState (std::istream& stream)
+	// Execute at most budget instructions from current PC using translated host code
+	const int Mops::executeCompiled (unsigned long long& budget)
 	{
-		// Line index
-		int index = 0;
-
-		// Line string
-		std::string line;
+		// Get memory pointer, current PC and signal
+		unsigned char * memory = getMemory();
+		int pc = getPC();
+		int signal;
 
-		// Temporary location and value
-		int location, value;
-
-		// Fetch each line until EOF reached
-		while (getline(stream, line))
+		// Run translated blocks while PC stays inside memory
+		while ((unsigned int) pc < (unsigned int) getMemorySize())
 		{
-			// Increment line index by 1
-			index++;
-
-			// Create input stream
-			std::istringstream sstream(line);
-
-			// Modify PC state
-			if (line.find("PC") != std::string::npos)
+			// If budget is used up, stop at the next instruction
+			if (!budget)
 			{
-				// Ignore 'PC='
-				sstream.ignore(3);
+				setPC(pc);
+				return Microcontroller::BUDGET_EXHAUSTED;
+			}
 
-				// If location cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> location))
+			// If no block can be run at PC (halt, invalid opcode, code
+			// modifying itself or block longer than the budget left), run a
+			// slice of the interpreter from there
+			if (!compiler->run(pc, memory, getPageFlags(), budget, getPublishedPC()))
+			{
+				unsigned long long slice = std::min(budget, INTERPRET_SLICE), left = slice;
+				setPC(pc);
+				signal = isProfiled() ? interpret<&Mops::step, true, PUBLISHED>(left)
+						: interpret<&Mops::step, true>(left);
+				budget -= slice - left;
+				if (signal != Microcontroller::BUDGET_EXHAUSTED)
 				{
-					return index;
+					return signal;
 				}
-
-				// Modify PC
-				setPC(location);
+				pc = getPC();
 			}
-			else
-			{
-				// Else, modify memory content
+		}
 
-				// If location cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> location))
-				{
-					return index;
-				}
+		// If PC go outside memory, return SIGWEED signal
+		// (a negative PC reads as an invalid opcode)
+		setPC(pc);
+		return pc < 0 ? Microcontroller::SIGOP : Microcontroller::SIGWEED;
+	}
 
-				// Ignore '='
-				sstream.ignore(1);
+	// Execute from current PC with the selected engine
+	template <bool BOUNDED>
+	const int Mops::runEngine (unsigned long long& budget)
+	{
+		// Count, trace or check execution with the interpreter if observed
+		if (isObserved())
+		{
+			return interpretObserved<&Mops::step, BOUNDED>(budget);
+		}
 
-				// If value cannot be retrieved, return failure (non-zero)
-				if (!(sstream >> value))
-				{
-					return index;
-				}
+		// Run translated host code if selected
+		if (getEngine() == JIT)
+		{
+			// Create translator on first use
+			if (!compiler)
+			{
+				compiler = new MopsCompiler(getMemorySize());
+			}
 
-				// Modify memory content
-				modify(location, value);
+			// If host code buffer is not available, fall back to the interpreter
+			if (compiler->isReady())
+			{
+				// Translated code always counts instructions, give it
+				// a budget that cannot run out when unbounded, and always
+				// publishes the PC of its blocks, so publish -1 after it
+				unsigned long long unlimited = ~0ULL;
+				int signal = executeCompiled(BOUNDED ? budget : unlimited);
+				publishPC(-1);
+				return signal;
 			}
 		}
 
-		// If no error occurs, return success (0)
-		return 0;
+		// Else, run the interpreter or the threaded engine
+		return MicrocontrollerCore<Mops, 1024>::runEngine<BOUNDED>(budget);
 	}
 }
 
@@ -10,27 +10,58 @@
 
 #include <string>
 #include <iostream>
-#include "Microcontroller.h"
+#include "MicrocontrollerCore.h"
+#include "MopsCompiler.h"
 
 namespace MicrocontrollerEmulation
 {
-	class Mops : public Microcontroller
+	class Mops : public MicrocontrollerCore<Mops, 1024>
 	{
+		friend class MicrocontrollerCore<Mops, 1024>;
+		friend struct InstructionSet<Mops>;
+
 	private:
-		static const int PC, MEM_SIZE;	// Initial PC and memory size
+		static const int PC;	// Initial PC
+		MopsCompiler * compiler;	// Translator of basic blocks into host code
 
 	public:
-		Mops(const std::string& type) : Microcontroller(type) {}	// Constructor with type
+		Mops(const std::string& type) : MicrocontrollerCore<Mops, 1024>(type), compiler(NULL) {}	// Constructor with type
+		~Mops() { delete compiler; }	// Destructor
+
+	private:
+		Mops(const Mops&);	// Not copyable
+		Mops& operator=(const Mops&);	// Not assignable
+
+	private:
+		const int add(const int& pc, int& next);	// Add value to memory
+		const int subtract(const int& pc, int& next);	// Subtract value from memory
+		const int jump(const int& pc, int& next);	// Go to address
+		const int branch(const int& pc, int& next);	// Branch relative
+		const int halt(const int& pc, int& next);	// Raise HALT
+		void written(const int& location);	// Keep host code in sync with a write
+		const int executeCompiled(unsigned long long& budget);	// Execute at most budget instructions from current PC using translated host code
+		template <bool BOUNDED> const int runEngine(unsigned long long& budget);	// Execute from current PC with the selected engine
+		void memoryLoaded();	// Drop host code after memory is replaced
 
 	public:
-		const int getMemorySize() const { return MEM_SIZE; }	// Get size of memory
+		const bool supportsEngine(const int& engine) const;	// Check if an execution engine is supported
 		void initialize();	// Reset microcontroller to initial state
-		const int execute(const int& location = -1);	// Execute from current PC or from a specific location
-		const unsigned char look(const int& location) const;	// Look at a specific memory location
-		void modify(const int& location, const unsigned char& value);	// Modify a specific memory locaiton
-		const std::string statusString() const;	// Return PC and registers
-		const std::string getState() const;	// Get current state
-		const int setState(std::istream& stream);	// Set state from stream
+	};
+
+	// Instruction set of Mops: opcode, mnemonic, operands, length, memory
+	// reads, memory writes, branch and handler
+	template <>
+	struct InstructionSet<Mops>
+	{
+		static constexpr Instruction<Mops> LIST[] = {
+			{0x0A, {"ADD", "ba", 4, 1, 1, false}, &Mops::add},
+			{0x13, {"SUB", "ba", 4, 1, 1, false}, &Mops::subtract},
+			{0x16, {"GOTO", "t", 3, 0, 0, false}, &Mops::jump},
+			{0x17, {"BRA", "r", 2, 0, 0, true}, &Mops::branch},
+			{0xFF, {"HALT", "", 1, 0, 0, false}, &Mops::halt}
+		};
+		static constexpr const char * REGISTERS[] = {NULL};	// No registers
+		static constexpr DecodeTable<Mops> TABLE = buildDecodeTable(LIST);
 	};
 }
 
@@ -0,0 +1,452 @@
+/*
+ * MopsCompiler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstddef>
+#include "MopsCompiler.h"
+
+/* HOST CODE LAYOUT:
+   - A block is called as "unsigned int block(memory, pages, budget,
+     pageFlags, published)", so memory base is in RDI, the block tables of
+     the guest pages in RSI, the budget counter in RDX, page flags in RCX
+     and the PC published for the profiler in R8. It returns the index of
+     the exit it left through in EAX.
+   - A block starts with "mov dword [r8], start", so chained blocks publish
+     their PC too, an aligned store being atomic on x86-64.
+   - It goes on with "cmp qword [rdx], count", leaves through an exit
+     back to its own start if the budget is smaller than its instruction
+     count, and else charges the whole count with "sub qword [rdx], count".
+   - 0x0A/0x13 become "add/sub byte [rdi + addr], value" and
+     "mov byte [rcx + page], PAGE_WRITTEN", followed by "mov rax, [rsi + page * 8]",
+     and, if the page has block tables, "cmp word [rax + coverage + offset * 2], 0"
+     and an exit taken when the written byte belongs to translated code.
+   - An exit is "mov eax, index; ret". Chaining overwrites its first 5 bytes
+     with "jmp rel32" to the next block, unchaining restores them.
+   - Guest bytes end up in host code, so no page is writable and executable
+     at once: the buffer is a memory file mapped twice, code being written
+     through the read-write view and run through the read-execute view at
+     the same offset. Relative jumps are the same in both views.
+*/
+
+namespace MicrocontrollerEmulation
+{
+	// Initialize host code buffer size, guest bytes per block and host bytes per block
+	const int MopsCompiler::CODE_SIZE = 1 << 20, MopsCompiler::MAX_BLOCK_SIZE = 256,
+		  MopsCompiler::MAX_BLOCK_CODE = 4096;
+
+	// Initialize writes into the blocks starting at a location before it is
+	// left to the interpreter, so self-modifying code is not translated again
+	// on every pass
+	const int MopsCompiler::MAX_INVALIDATIONS = 4;
+
+	// Emit a 32-bit little-endian value
+	static void emit32 (unsigned char *& code, const int& value)
+	{
+		std::memcpy(code, &value, 4);
+		code += 4;
+	}
+
+	// Constructor with memory size
+	MopsCompiler::MopsCompiler (const int& memorySizeInput) :
+			memorySize(memorySizeInput), buffer(NULL), executable(NULL), used(0),
+			pages((memorySizeInput + PAGE_SIZE - 1) / PAGE_SIZE, (Page *) NULL),
+			lastExit(-1)
+	{
+		// Map host code buffer twice, writable and executable
+		int file = isSupported() ? memfd_create("MopsCompiler", MFD_CLOEXEC) : -1;
+		if (file != -1)
+		{
+			void * writing = MAP_FAILED, * running = MAP_FAILED;
+			if (!ftruncate(file, CODE_SIZE))
+			{
+				writing = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+				running = mmap(NULL, CODE_SIZE, PROT_READ | PROT_EXEC, MAP_SHARED, file, 0);
+			}
+
+			// If either view is missing, leave the buffer unavailable
+			if (writing != MAP_FAILED && running != MAP_FAILED)
+			{
+				buffer = (unsigned char *) writing;
+				executable = (unsigned char *) running;
+			}
+			else
+			{
+				if (writing != MAP_FAILED)
+				{
+					munmap(writing, CODE_SIZE);
+				}
+				if (running != MAP_FAILED)
+				{
+					munmap(running, CODE_SIZE);
+				}
+			}
+
+			// The mappings keep the memory file alive
+			close(file);
+		}
+	}
+
+	// Destructor
+	MopsCompiler::~MopsCompiler ()
+	{
+		// Delete blocks and unmap both views of host code
+		flush();
+		if (buffer)
+		{
+			munmap(buffer, CODE_SIZE);
+			munmap(executable, CODE_SIZE);
+		}
+	}
+
+	// Check if host code can be generated on this machine
+	const bool MopsCompiler::isSupported ()
+	{
+#if defined(__x86_64__)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// Run translated code from PC, publishing the PC of each block, return
+	// false if no block fits there
+	const bool MopsCompiler::run (int& pc, unsigned char * memory,
+			unsigned char * pageFlags, unsigned long long& budget,
+			std::atomic<int> * published)
+	{
+		typedef unsigned int (* Code)(unsigned char *, Page * const *,
+				unsigned long long *, unsigned char *, std::atomic<int> *);
+
+		// Get block at PC, translate it if needed unless code there keeps
+		// modifying itself, and check it fits the budget
+		Page * page = pages[pc / PAGE_SIZE];
+		Block * block = page ? page->blocks[pc % PAGE_SIZE] : NULL;
+		if ((!block && ((page && page->invalidations[pc % PAGE_SIZE] >= MAX_INVALIDATIONS)
+					|| !(block = translate(pc, memory))))
+				|| (unsigned long long) block->count > budget)
+		{
+			lastExit = -1;
+			return false;
+		}
+
+		// Chain previous block into this one, so it is not dispatched again
+		if (lastExit != -1)
+		{
+			link(lastExit, block);
+		}
+
+		// Run host code through the executable view until it leaves through an exit
+		int exit = reinterpret_cast<Code>(executable + (block->code - buffer))(memory,
+				&pages[0], &budget, pageFlags, published);
+		pc = exits[exit].nextPC;
+		budget += exits[exit].refund;
+
+		// Remember exit for chaining, but if translated code was written,
+		// drop the blocks covering it
+		lastExit = exits[exit].chainable ? exit : -1;
+		if (exits[exit].written != -1)
+		{
+			invalidate(exits[exit].written);
+		}
+
+		return true;
+	}
+
+	// Drop blocks covering a memory location
+	void MopsCompiler::invalidate (const int& location)
+	{
+		// If location is not covered by any block, do nothing
+		if (location < 0 || location >= memorySize || !pages[location / PAGE_SIZE]
+				|| !pages[location / PAGE_SIZE]->coverage[location % PAGE_SIZE])
+		{
+			return;
+		}
+
+		// A block covers at most MAX_BLOCK_SIZE + 3 bytes from its start,
+		// count the blocks dropped at each start
+		for (int i = std::max(location - MAX_BLOCK_SIZE - 3, 0); i <= location; i++)
+		{
+			Page * page = pages[i / PAGE_SIZE];
+			if (page && page->blocks[i % PAGE_SIZE]
+					&& page->blocks[i % PAGE_SIZE]->end > location)
+			{
+				remove(page->blocks[i % PAGE_SIZE]);
+				if (page->invalidations[i % PAGE_SIZE] < MAX_INVALIDATIONS)
+				{
+					page->invalidations[i % PAGE_SIZE]++;
+				}
+			}
+		}
+	}
+
+	// Drop all blocks, visiting only the blocks and pages in use
+	void MopsCompiler::flush ()
+	{
+		for (int i = 0; i < (int) live.size(); i++)
+		{
+			delete live[i];
+		}
+		live.clear();
+		for (int i = 0; i < (int) allocated.size(); i++)
+		{
+			delete pages[allocated[i]];
+			pages[allocated[i]] = NULL;
+		}
+		allocated.clear();
+		exits.clear();
+		used = 0;
+		lastExit = -1;
+	}
+
+	// Translate basic block starting at PC
+	MopsCompiler::Block * MopsCompiler::translate (const int& pc, const unsigned char * memory)
+	{
+		// If host code buffer is missing, do not translate
+		if (!buffer)
+		{
+			return NULL;
+		}
+
+		// If host code buffer may overflow, start over
+		if (used + MAX_BLOCK_CODE > CODE_SIZE)
+		{
+			flush();
+		}
+
+		// Create block at the free end of the buffer
+		Block * block = new Block;
+		block->start = pc;
+		block->code = buffer + used;
+		unsigned char * code = block->code;
+
+		// mov dword [r8], pc
+		*code++ = 0x41;
+		*code++ = 0xC7;
+		*code++ = 0x00;
+		emit32(code, pc);
+
+		// cmp qword [rdx], count (count is filled in at the end)
+		unsigned char * count = code + 3;
+		*code++ = 0x48;
+		*code++ = 0x83;
+		*code++ = 0x3A;
+		*code++ = 0x00;
+
+		// jae over the exit taken when the budget is too small
+		*code++ = 0x73;
+		*code++ = 0x06;
+		emitExit(code, pc, -1, false);
+
+		// sub qword [rdx], count
+		unsigned char * charge = code + 3;
+		*code++ = 0x48;
+		*code++ = 0x83;
+		*code++ = 0x2A;
+		*code++ = 0x00;
+
+		// Translate instructions until a branch or an untranslatable opcode,
+		// remembering exits that leave in the middle of the block
+		std::vector<int> early, executed;
+		int location = pc, address;
+		bool open = true;
+		block->count = 0;
+		while (open)
+		{
+			// If block runs past memory or gets too long, continue at next block
+			if (location >= memorySize || location - pc >= MAX_BLOCK_SIZE)
+			{
+				emitExit(code, location);
+				break;
+			}
+
+			switch (memory[location])
+			{
+				case 0x0A:
+				case 0x13:
+					// Add/subtract value to memory (operands past memory read
+					// from the zeroed guard bytes)
+					address = ((int) memory[location + 2] << 8) | memory[location + 3];
+
+					// Targets outside memory are ignored
+					if (address < memorySize)
+					{
+						// add/sub byte [rdi + address], value
+						*code++ = 0x80;
+						*code++ = memory[location] == 0x0A ? 0x87 : 0xAF;
+						emit32(code, address);
+						*code++ = memory[location + 1];
+
+						// mov byte [rcx + page], PAGE_WRITTEN
+						*code++ = 0xC6;
+						*code++ = 0x81;
+						emit32(code, address >> Microcontroller::PAGE_SHIFT);
+						*code++ = Microcontroller::PAGE_WRITTEN;
+
+						// mov rax, [rsi + page * 8]
+						*code++ = 0x48;
+						*code++ = 0x8B;
+						*code++ = 0x86;
+						emit32(code, (address / PAGE_SIZE) * sizeof(Page *));
+
+						// test rax, rax, and jz over the check of a page
+						// without block tables
+						*code++ = 0x48;
+						*code++ = 0x85;
+						*code++ = 0xC0;
+						*code++ = 0x74;
+						*code++ = 0x10;
+
+						// cmp word [rax + coverage + offset * 2], 0
+						*code++ = 0x66;
+						*code++ = 0x83;
+						*code++ = 0xB8;
+						emit32(code, offsetof(Page, coverage)
+								+ (address % PAGE_SIZE) * sizeof(unsigned short));
+						*code++ = 0x00;
+
+						// je over the exit taken when translated code was written
+						*code++ = 0x74;
+						*code++ = 0x06;
+						early.push_back(emitExit(code, location + 4, address, false));
+						executed.push_back(block->count + 1);
+					}
+					location += 4;
+					block->count++;
+					break;
+				case 0x16:
+					// Go to address
+					emitExit(code, ((int) memory[location + 1] << 8) | memory[location + 2]);
+					location += 3;
+					block->count++;
+					open = false;
+					break;
+				case 0x17:
+					// Branch relative
+					emitExit(code, location + (int)((char) memory[location + 1]));
+					location += 2;
+					block->count++;
+					open = false;
+					break;
+				default:
+					// Halt and invalid opcodes are left to the interpreter
+					if (location == pc)
+					{
+						delete block;
+						return NULL;
+					}
+					emitExit(code, location);
+					open = false;
+					break;
+			}
+		}
+
+		// Fill in instruction count, and refund instructions skipped by early exits
+		*count = *charge = block->count;
+		for (int i = 0; i < (int) early.size(); i++)
+		{
+			exits[early[i]].refund = block->count - executed[i];
+		}
+
+		// Register block and the memory it covers
+		block->end = std::min(location, memorySize);
+		for (int i = block->start; i < block->end; i++)
+		{
+			getPage(i)->coverage[i % PAGE_SIZE]++;
+		}
+		getPage(pc)->blocks[pc % PAGE_SIZE] = block;
+		block->index = live.size();
+		live.push_back(block);
+		used = code - buffer;
+
+		return block;
+	}
+
+	// Get block tables of the page of a location, allocating them if needed
+	MopsCompiler::Page * MopsCompiler::getPage (const int& location)
+	{
+		Page *& page = pages[location / PAGE_SIZE];
+		if (!page)
+		{
+			page = new Page();
+			allocated.push_back(location / PAGE_SIZE);
+		}
+		return page;
+	}
+
+	// Drop a block and unchain exits into it
+	void MopsCompiler::remove (Block * block)
+	{
+		// Unchain exits still jumping into the block
+		for (int i = 0; i < (int) block->incoming.size(); i++)
+		{
+			if (exits[block->incoming[i]].target == block)
+			{
+				unlink(block->incoming[i]);
+			}
+		}
+
+		// Release memory covered by the block, and take it out of the live
+		// blocks
+		for (int i = block->start; i < block->end; i++)
+		{
+			pages[i / PAGE_SIZE]->coverage[i % PAGE_SIZE]--;
+		}
+		pages[block->start / PAGE_SIZE]->blocks[block->start % PAGE_SIZE] = NULL;
+		live[block->index] = live.back();
+		live[block->index]->index = block->index;
+		live.pop_back();
+		delete block;
+
+		// The previous exit may belong to the dropped block
+		lastExit = -1;
+	}
+
+	// Chain an exit straight into a block
+	void MopsCompiler::link (const int& exit, Block * block)
+	{
+		// jmp rel32
+		unsigned char * stub = exits[exit].stub;
+		int offset = block->code - (stub + 5);
+		stub[0] = 0xE9;
+		std::memcpy(stub + 1, &offset, 4);
+
+		exits[exit].target = block;
+		block->incoming.push_back(exit);
+	}
+
+	// Make a chained exit return to the dispatcher again
+	void MopsCompiler::unlink (const int& exit)
+	{
+		// mov eax, exit
+		unsigned char * stub = exits[exit].stub;
+		stub[0] = 0xB8;
+		std::memcpy(stub + 1, &exit, 4);
+
+		exits[exit].target = NULL;
+	}
+
+	// Emit exit stub, return its index
+	const int MopsCompiler::emitExit (unsigned char *& code, const int& nextPC,
+			const int& written, const bool& chainable)
+	{
+		Exit exit = {code, nextPC, written, 0, chainable, NULL};
+
+		// mov eax, exit; ret
+		*code++ = 0xB8;
+		emit32(code, exits.size());
+		*code++ = 0xC3;
+
+		exits.push_back(exit);
+		return exits.size() - 1;
+	}
+}
+
+
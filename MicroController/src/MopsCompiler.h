@@ -0,0 +1,95 @@
+/*
+ * MopsCompiler.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_MOPSCOMPILER_H_
+#define SRC_MOPSCOMPILER_H_
+
+#include <atomic>
+#include <vector>
+#include "Microcontroller.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Translates R500 basic blocks into x86-64 host code
+	class MopsCompiler
+	{
+	private:
+		static const int CODE_SIZE, MAX_BLOCK_SIZE, MAX_BLOCK_CODE;	// Host code buffer size, guest bytes per block and host bytes per block
+		static const int MAX_INVALIDATIONS;	// Writes into the blocks starting at a location before it is left to the interpreter
+
+		static const int PAGE_SIZE = 1 << Microcontroller::PAGE_SHIFT;	// Guest bytes per page of the block tables
+
+		// Translated basic block
+		struct Block
+		{
+			int start, end;	// Guest memory covered by the block
+			int count;	// Number of instructions in the block
+			int index;	// Position in the list of live blocks
+			unsigned char * code;	// Host code entry, in the writable view
+			std::vector<int> incoming;	// Exits chained straight into this block
+		};
+
+		// Block tables of a guest page, allocated on first translation
+		struct Page
+		{
+			Block * blocks[PAGE_SIZE];	// Translated blocks by start PC
+			unsigned short coverage[PAGE_SIZE];	// Number of blocks covering each memory location
+			unsigned char invalidations[PAGE_SIZE];	// Number of blocks starting at each location dropped for a write into them
+		};
+
+		// Exit of a translated block, host code returns its index
+		struct Exit
+		{
+			unsigned char * stub;	// Host code of the exit
+			int nextPC;	// PC to continue at
+			int written;	// Location of translated code written before leaving, or -1
+			int refund;	// Instructions charged to the budget but not executed
+			bool chainable;	// Whether the exit may be chained into the next block
+			Block * target;	// Block the exit is chained to
+		};
+
+		const int memorySize;	// Size of guest memory
+		unsigned char * buffer;	// Host code buffer, mapped writable
+		unsigned char * executable;	// Same buffer, mapped executable
+		int used;	// Bytes of host code buffer in use
+		std::vector<Page *> pages;	// Block tables of each guest page, NULL until code there is translated
+		std::vector<int> allocated;	// Guest pages with block tables
+		std::vector<Block *> live;	// Translated blocks
+		std::vector<Exit> exits;	// Exits of translated blocks
+		int lastExit;	// Exit taken by the previous block, or -1 if it cannot be chained
+
+	public:
+		MopsCompiler(const int& memorySize);	// Constructor with memory size
+		~MopsCompiler();	// Destructor
+
+	private:
+		MopsCompiler(const MopsCompiler&);	// Not copyable
+		MopsCompiler& operator=(const MopsCompiler&);	// Not assignable
+
+	public:
+		static const bool isSupported();	// Check if host code can be generated on this machine
+		const bool isReady() const { return buffer != NULL; }	// Check if host code buffer is available
+		const int getMemorySize() const { return memorySize; }	// Get size of guest memory
+		const bool run(int& pc, unsigned char * memory, unsigned char * pageFlags,
+				unsigned long long& budget, std::atomic<int> * published);	// Run translated code from PC, publishing the PC of each block, return false if no block fits there
+		void invalidate(const int& location);	// Drop blocks covering a memory location
+		void flush();	// Drop all blocks
+
+	private:
+		Block * translate(const int& pc, const unsigned char * memory);	// Translate basic block starting at PC
+		Page * getPage(const int& location);	// Get block tables of the page of a location, allocating them if needed
+		void remove(Block * block);	// Drop a block and unchain exits into it
+		void link(const int& exit, Block * block);	// Chain an exit straight into a block
+		void unlink(const int& exit);	// Make a chained exit return to the dispatcher again
+		const int emitExit(unsigned char *& code, const int& nextPC,
+				const int& written = -1, const bool& chainable = true);	// Emit exit stub, return its index
+	};
+}
+
+
+
+#endif /* SRC_MOPSCOMPILER_H_ */
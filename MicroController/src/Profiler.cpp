@@ -0,0 +1,155 @@
+/*
+ * Profiler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <iterator>
+#include "Profiler.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Start sampling every interval microseconds
+	void Profiler::start (const int& intervalInput)
+	{
+		// If already sampling, keep going
+		if (sampler.joinable())
+		{
+			return;
+		}
+
+		interval = std::max(intervalInput, 1);
+		running = true;
+		sampler = std::thread(&Profiler::sample, this);
+	}
+
+	// Stop sampling, keeping the samples
+	void Profiler::stop ()
+	{
+		if (sampler.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				running = false;
+			}
+			signal.notify_one();
+			sampler.join();
+		}
+	}
+
+	// Drop all samples
+	void Profiler::reset ()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		histogram.clear();
+		samples = idle = 0;
+	}
+
+	// Sample PC every interval until stopped
+	void Profiler::sample ()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		std::chrono::microseconds period(interval);
+
+		// Wake up once per interval, the lock is held while counting
+		while (!signal.wait_for(guard, period, [this] { return !running; }))
+		{
+			int pc = microcontroller->getSampledPC();
+			samples++;
+			if ((unsigned int) pc < (unsigned int) memorySize)
+			{
+				histogram[pc]++;
+			}
+			else
+			{
+				idle++;
+			}
+		}
+	}
+
+	// Return hottest addresses and loops
+	const std::string Profiler::reportString (const int& top) const
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		// Create output string stream
+		std::ostringstream stream;
+		stream << std::fixed << std::setprecision(1);
+
+		// Percentages are of samples taken while executing
+		unsigned long long busy = samples - idle;
+		stream << "Profile: " << samples << " samples every " << interval
+			   << " us, " << busy << " while executing\n";
+		if (!busy)
+		{
+			return stream.str();
+		}
+
+		// Rank sampled addresses and find back-edges among them
+		// (a branch to a location not after itself closes a loop)
+		std::vector<std::pair<unsigned long long, int> > hot;
+		std::vector<std::pair<unsigned long long, std::pair<int, int> > > loops;
+		std::map<int, unsigned long long>::const_iterator sampled, body;
+		for (sampled = histogram.begin(); sampled != histogram.end(); ++sampled)
+		{
+			int i = sampled->first;
+			hot.push_back(std::make_pair(sampled->second, i));
+
+			int target = microcontroller->branchTarget(i);
+			if (target >= 0 && target <= i)
+			{
+				unsigned long long count = 0;
+				for (body = histogram.lower_bound(target); body != std::next(sampled); ++body)
+				{
+					count += body->second;
+				}
+				loops.push_back(std::make_pair(count, std::make_pair(target, i)));
+			}
+		}
+		std::sort(hot.rbegin(), hot.rend());
+		std::sort(loops.rbegin(), loops.rend());
+
+		// Add hottest addresses with their instruction
+		stream << "Hottest addresses:\n";
+		for (int i = 0; i < (int) hot.size() && i < top; i++)
+		{
+			stream << "  " << std::setw(5) << 100.0 * hot[i].first / busy << " %  "
+				   << microcontroller->disassemble(hot[i].second) << '\n';
+		}
+
+		// Add hottest loops with the instructions of their body
+		stream << "Loops:\n";
+		for (int i = 0; i < (int) loops.size() && i < top; i++)
+		{
+			int start = loops[i].second.first, end = loops[i].second.second;
+			stream << "  " << std::setw(5) << 100.0 * loops[i].first / busy << " %  0x"
+				   << std::hex << std::setw(3) << std::setfill('0') << start << "-0x"
+				   << std::setw(3) << end << std::dec << std::setfill(' ') << '\n';
+
+			// Walk the body instruction by instruction, at most 16 of them
+			for (int location = start, count = 0; location <= end && count < 16; count++)
+			{
+				body = histogram.find(location);
+				stream << "          " << std::setw(6)
+					   << (body != histogram.end() ? body->second : 0) << "  "
+					   << microcontroller->disassemble(location) << '\n';
+
+				const Microcontroller::InstructionInfo * info =
+						microcontroller->describeInstruction(microcontroller->look(location));
+				location += info ? info->length : 1;
+			}
+		}
+
+		// Return report string
+		return stream.str();
+	}
+}
+
+
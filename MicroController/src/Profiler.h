@@ -0,0 +1,57 @@
+/*
+ * Profiler.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_PROFILER_H_
+#define SRC_PROFILER_H_
+
+#include <string>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Microcontroller.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Samples the PC published by an executing microcontroller from another
+	// thread, so execution itself only pays for a store per instruction
+	class Profiler
+	{
+	private:
+		const Microcontroller * microcontroller;	// Sampled microcontroller
+		const int memorySize;	// Size of sampled memory
+		std::map<int, unsigned long long> histogram;	// Samples per memory location sampled, so large memories cost nothing
+		unsigned long long samples, idle;	// Samples taken in total and while not executing
+		int interval;	// Microseconds between samples
+		bool running;	// Whether the sampler should keep running
+		mutable std::mutex lock;	// Lock of samples and running flag
+		std::condition_variable signal;	// Wakes sampler up when stopped
+		std::thread sampler;	// Sampler thread
+
+	public:
+		Profiler(const Microcontroller * microcontrollerInput) :
+				microcontroller(microcontrollerInput),
+				memorySize(microcontrollerInput->getMemorySize()),
+				samples(0), idle(0), interval(100), running(false) {}	// Constructor with sampled microcontroller
+		~Profiler() { stop(); }	// Destructor
+
+	private:
+		Profiler(const Profiler&);	// Not copyable
+		Profiler& operator=(const Profiler&);	// Not assignable
+		void sample();	// Sample PC every interval until stopped
+
+	public:
+		void start(const int& intervalInput);	// Start sampling every interval microseconds
+		void stop();	// Stop sampling, keeping the samples
+		void reset();	// Drop all samples
+		const std::string reportString(const int& top) const;	// Return hottest addresses and loops
+	};
+}
+
+
+
+#endif /* SRC_PROFILER_H_ */
@@ -0,0 +1,215 @@
+/*
+ * ScriptRunner.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <string>
+#include <streambuf>
+#include "ScriptRunner.h"
+#include "utility.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Stream buffer discarding everything, used to silence commands
+	class NullBuffer : public std::streambuf
+	{
+	protected:
+		int overflow(int c) { return c; }
+	};
+
+	// Parse hexadecimal number of at most 7 digits, with an optional 0x
+	// prefix, ending at a space or the end of line. Return the position after
+	// it, or NULL if it is malformed
+	static const char * parseHex (const char * position, const char * end, int& value)
+	{
+		// Skip prefix
+		if (end - position > 2 && position[0] == '0' && (position[1] | 0x20) == 'x')
+		{
+			position += 2;
+		}
+
+		// Accumulate digits
+		const char * start = position;
+		value = 0;
+		for (; position < end && *position != ' '; position++)
+		{
+			char current = *position | 0x20;
+			if (current >= '0' && current <= '9')
+			{
+				value = (value << 4) | (current - '0');
+			}
+			else if (current >= 'a' && current <= 'f')
+			{
+				value = (value << 4) | (current - 'a' + 10);
+			}
+			else
+			{
+				return NULL;
+			}
+		}
+
+		return position > start && position - start <= 7 ? position : NULL;
+	}
+
+	// Run a well-formed Look or Modify command, return false if it is not one
+	const bool ScriptRunner::runFast (const char * line, const char * end,
+			Microcontroller * microcontroller)
+	{
+		// Command character must be followed by a single space
+		if (!microcontroller || end - line < 3 || line[1] != ' ')
+		{
+			return false;
+		}
+		char command = line[0] | 0x20;
+		if (command != 'l' && command != 'm')
+		{
+			return false;
+		}
+
+		// Get location, out of range locations are reported by utilize()
+		int location, value;
+		const char * position = parseHex(line + 2, end, location);
+		if (!position || location >= microcontroller->getMemorySize())
+		{
+			return false;
+		}
+
+		// Look at memory location
+		if (command == 'l')
+		{
+			if (position != end)
+			{
+				return false;
+			}
+
+			static const char DIGITS[] = "0123456789abcdef";
+			unsigned char content = microcontroller->look(location);
+			output.append("The value is: 0x");
+			output.push_back(DIGITS[content >> 4]);
+			output.push_back(DIGITS[content & 0xF]);
+			output.push_back('\n');
+			if (output.size() > 1 << 16)
+			{
+				flush();
+			}
+			return true;
+		}
+
+		// Else, modify memory location, only the right most byte is stored
+		if (position == end || *position != ' '
+				|| (position = parseHex(position + 1, end, value)) != end)
+		{
+			return false;
+		}
+		microcontroller->modify(location, (unsigned char) (value & 0xFF));
+		if (getSessionLog())
+		{
+			getSessionLog()->record('m', microcontroller, 2, location, value & 0xFF);
+		}
+		return true;
+	}
+
+	// Validate and utilize any other command
+	void ScriptRunner::runSlow (const std::string& line, const int& index,
+			Microcontroller *& microcontroller)
+	{
+		// If command is invalid, display error message with its line
+		if (!isValidCommand(line))
+		{
+			invalid++;
+			std::cerr << "Invalid command at line " << std::dec << index
+					  << "! Type 'h' for help." << std::endl;
+			return;
+		}
+
+		// Keep output in order
+		flush();
+
+		// If quiet, silence commands other than Breakpoint, Display, Fleet,
+		// Help, Look, Search, Profile, Status, Compare and Watchpoint, whose
+		// output is requested
+		char command = line[0] | 0x20;
+		NullBuffer discard;
+		std::streambuf * console = NULL;
+		if (quiet && !(command == 'b' || command == 'd' || command == 'f'
+				|| command == 'h' || command == 'l' || command == 'o'
+				|| command == 'p' || command == 's' || command == 'u'
+				|| command == 'w'))
+		{
+			console = std::cout.rdbuf(&discard);
+		}
+
+		utilize(line, factory, microcontroller);
+
+		if (console)
+		{
+			std::cout.rdbuf(console);
+		}
+	}
+
+	// Write output buffer
+	void ScriptRunner::flush ()
+	{
+		if (output.size())
+		{
+			std::cout.write(output.data(), output.size());
+			std::cout.flush();
+			output.clear();
+		}
+	}
+
+	// Run commands until Quit or end of stream, return number of invalid lines
+	const int ScriptRunner::run (std::istream& stream, Microcontroller *& microcontroller)
+	{
+		// Read whole script
+		std::string script;
+		char chunk[1 << 16];
+		while (stream.read(chunk, sizeof(chunk)) || stream.gcount())
+		{
+			script.append(chunk, stream.gcount());
+		}
+
+		// Run one line at a time, in place
+		const char * position = script.data(), * last = position + script.size();
+		for (int index = 1; position < last; index++)
+		{
+			// Find end of line, ignoring a carriage return
+			const char * end = position;
+			while (end < last && *end != '\n')
+			{
+				end++;
+			}
+			const char * next = end + 1;
+			if (end > position && end[-1] == '\r')
+			{
+				end--;
+			}
+
+			// Skip empty lines and comments, stop at Quit
+			if (end > position && *position != '#'
+					&& !runFast(position, end, microcontroller))
+			{
+				if ((*position | 0x20) == 'q' && end - position == 1)
+				{
+					break;
+				}
+				runSlow(std::string(position, end), index, microcontroller);
+			}
+
+			position = next;
+		}
+
+		// Present output of the last fast commands, e.g. the screen
+		flush();
+		if (microcontroller)
+		{
+			microcontroller->present();
+		}
+
+		return invalid;
+	}
+}
+
+
@@ -0,0 +1,47 @@
+/*
+ * ScriptRunner.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_SCRIPTRUNNER_H_
+#define SRC_SCRIPTRUNNER_H_
+
+#include <string>
+#include <iostream>
+#include "Microcontroller.h"
+#include "MicrocontrollerFactory.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Runs a command script without prompts or echo. Look and Modify commands
+	// with hexadecimal parameters are parsed in place and answered into an
+	// output buffer, other commands go through utilize()
+	class ScriptRunner
+	{
+	private:
+		const MicrocontrollerFactory * factory;	// Microcontroller producer
+		bool quiet;	// Whether only errors and requested output are written
+		std::string output;	// Output of fast commands not written yet
+		int invalid;	// Number of invalid command lines
+
+	public:
+		ScriptRunner(const MicrocontrollerFactory * factoryInput, const bool& quietInput) :
+				factory(factoryInput), quiet(quietInput), invalid(0) {}	// Constructor with factory and quiet flag
+
+	private:
+		const bool runFast(const char * line, const char * end,
+				Microcontroller * microcontroller);	// Run a well-formed Look or Modify command, return false if it is not one
+		void runSlow(const std::string& line, const int& index,
+				Microcontroller *& microcontroller);	// Validate and utilize any other command
+		void flush();	// Write output buffer
+
+	public:
+		const int run(std::istream& stream, Microcontroller *& microcontroller);	// Run commands until Quit or end of stream, return number of invalid lines
+	};
+}
+
+
+
+#endif /* SRC_SCRIPTRUNNER_H_ */
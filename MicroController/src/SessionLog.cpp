@@ -0,0 +1,193 @@
+/*
+ * SessionLog.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <cstring>
+#include "SessionLog.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Leading bytes and version of session logs
+	const char SessionLog::SESSION_MAGIC[4] = {'M', 'C', 'S', 'L'};
+	const unsigned short SessionLog::SESSION_VERSION = 1;
+
+	// Longest time entries stay buffered while commands are recorded
+	const std::chrono::milliseconds SessionLog::FLUSH_INTERVAL(1000);
+
+	// Largest text of an entry, the largest state loaded being below it
+	static const unsigned long long MAX_TEXT_SIZE = 1ULL << 30;
+
+	// Append an unsigned LEB128 varint to a buffer
+	static void appendVarint (std::string& buffer, unsigned long long value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((char) (value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((char) value);
+	}
+
+	// Read an unsigned LEB128 varint, return false if it is truncated
+	static const bool readVarint (std::istream& stream, unsigned long long& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			int byte = stream.get();
+			if (byte == EOF)
+			{
+				return false;
+			}
+			value |= (unsigned long long) (byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Constructor with log stream, writing the header
+	SessionLog::SessionLog (std::ostream& streamInput) : stream(streamInput),
+			flushed(std::chrono::steady_clock::now())
+	{
+		stream.write(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+		stream.write((const char *) &SESSION_VERSION, sizeof(SESSION_VERSION));
+		stream.flush();
+	}
+
+	// Destructor, flushing the entries left in the stream
+	SessionLog::~SessionLog ()
+	{
+		stream.flush();
+	}
+
+	// Record a command with up to 3 arguments, its signal (-1 if none) and
+	// the resulting state of the microcontroller, unless the arguments
+	// imply it (c, m, b, w and k). Entries stay in the stream buffer and
+	// are flushed once FLUSH_INTERVAL has passed since the last flush, so
+	// batch scripts do not pay a write per command while an abrupt end
+	// loses at most the last interval of the log
+	void SessionLog::record (const char& command,
+			const Microcontroller * microcontroller, const int& count,
+			const unsigned long long& first, const unsigned long long& second,
+			const unsigned long long& third, const int& signal,
+			const std::string& text)
+	{
+		bool stated = !(command == 'c' || command == 'm' || command == 'b'
+				|| command == 'w' || command == 'k');
+		unsigned long long arguments[3] = {first, second, third};
+
+		// Command and flags
+		std::string buffer;
+		buffer.push_back(command);
+		buffer.push_back((char) ((signal >= 0 ? HAS_SIGNAL : 0)
+				| (stated ? HAS_STATE : 0) | (text.length() ? HAS_TEXT : 0)
+				| count << COUNT_SHIFT));
+
+		// Arguments, signal, state and text, if any
+		for (int i = 0; i < count; i++)
+		{
+			appendVarint(buffer, arguments[i]);
+		}
+		if (signal >= 0)
+		{
+			buffer.push_back((char) signal);
+		}
+		if (stated)
+		{
+			unsigned long long digest = microcontroller->digest();
+			appendVarint(buffer, microcontroller->getPC());
+			buffer.append((const char *) &digest, sizeof(digest));
+		}
+		if (text.length())
+		{
+			appendVarint(buffer, text.length());
+			buffer.append(text);
+		}
+
+		// Write entry, flushing if the interval has passed
+		stream.write(buffer.data(), buffer.size());
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - flushed >= FLUSH_INTERVAL)
+		{
+			stream.flush();
+			flushed = now;
+		}
+	}
+
+	// Read and check header of a log, return false if it is not a session log
+	const bool SessionLog::readHeader (std::istream& stream)
+	{
+		char magic[sizeof(SESSION_MAGIC)];
+		unsigned short version;
+		return stream.read(magic, sizeof(magic))
+				&& !std::memcmp(magic, SESSION_MAGIC, sizeof(magic))
+				&& stream.read((char *) &version, sizeof(version))
+				&& version == SESSION_VERSION;
+	}
+
+	// Read next entry, return 1 if read, 0 at the end of the log and -1 if
+	// it is truncated or malformed
+	const int SessionLog::read (std::istream& stream, SessionEntry& entry)
+	{
+		// Command and flags, the log ending before a command
+		int command = stream.get();
+		if (command == EOF)
+		{
+			return 0;
+		}
+		int flags = stream.get();
+		if (flags == EOF || (flags >> COUNT_SHIFT) > 3)
+		{
+			return -1;
+		}
+		entry.command = (char) command;
+		entry.count = flags >> COUNT_SHIFT;
+
+		// Arguments, signal, state and text, if flagged
+		for (int i = 0; i < 3; i++)
+		{
+			entry.arguments[i] = 0;
+			if (i < entry.count && !readVarint(stream, entry.arguments[i]))
+			{
+				return -1;
+			}
+		}
+		entry.signal = -1;
+		if ((flags & HAS_SIGNAL) && (entry.signal = stream.get()) == EOF)
+		{
+			return -1;
+		}
+		entry.stated = flags & HAS_STATE;
+		entry.digest = 0;
+		unsigned long long value = 0;
+		if (entry.stated && !(readVarint(stream, value)
+				&& stream.read((char *) &entry.digest, sizeof(entry.digest))))
+		{
+			return -1;
+		}
+		entry.pc = (int) value;
+		entry.text.clear();
+		if (flags & HAS_TEXT)
+		{
+			if (!readVarint(stream, value) || value > MAX_TEXT_SIZE)
+			{
+				return -1;
+			}
+			entry.text.resize(value);
+			if (!stream.read(&entry.text[0], value))
+			{
+				return -1;
+			}
+		}
+
+		return 1;
+	}
+}
+
+
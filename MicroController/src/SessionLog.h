@@ -0,0 +1,90 @@
+/*
+ * SessionLog.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_SESSIONLOG_H_
+#define SRC_SESSIONLOG_H_
+
+#include <string>
+#include <iostream>
+#include <chrono>
+#include "Microcontroller.h"
+
+/* SESSION LOG FORMAT:
+   - The log starts with SESSION_MAGIC and a 16-bit SESSION_VERSION (host
+     byte order), followed by one entry per command changing the
+     microcontroller, until the end of the file.
+   - An entry is the command character, a flags byte (HAS_SIGNAL,
+     HAS_STATE, HAS_TEXT, number of arguments in the upper bits), the
+     arguments as LEB128 varints, the signal byte, the PC varint and 64-bit
+     digest of the resulting state, and the text as a varint length and its
+     bytes, each only if flagged.
+   - Commands are c (type, engine, memory size), r, m (location, value),
+     e, g (location), n (count), t, < (state loaded, as a binary
+     snapshot, or a text state in older logs), b (location),
+     w (start, end, kind), k (number, 0 for all), z (mode, value) and q
+     (end of session, with the final state).
+*/
+
+namespace MicrocontrollerEmulation
+{
+	// Command of a session changing the microcontroller, its parsed
+	// arguments and its outcome
+	struct SessionEntry
+	{
+		char command;	// Command character
+		int count;	// Number of arguments
+		unsigned long long arguments[3];	// Parsed arguments
+		int signal;	// Signal of execution, -1 if none
+		bool stated;	// Whether PC and digest of the resulting state are recorded
+		int pc;	// Resulting PC
+		unsigned long long digest;	// Digest of resulting PC, registers and memory
+		std::string text;	// Type connected or snapshot of state loaded, empty if none
+	};
+
+	// Compact binary log of a session, written while commands run and read
+	// back to replay them
+	class SessionLog
+	{
+	public:
+		static const char SESSION_MAGIC[4];	// Leading bytes of session logs
+		static const unsigned short SESSION_VERSION;	// Version of session log format
+		enum {
+			HAS_SIGNAL = 1, HAS_STATE = 2, HAS_TEXT = 4, COUNT_SHIFT = 4
+		};	// Entry flags, the number of arguments being above COUNT_SHIFT
+		enum {
+			REVERSE_ON, REVERSE_OFF, REVERSE_BACK, REVERSE_WRITE
+		};	// Modes of the z command
+
+	private:
+		static const std::chrono::milliseconds FLUSH_INTERVAL;	// Longest time entries stay buffered while commands are recorded
+		std::ostream& stream;	// Log stream
+		std::chrono::steady_clock::time_point flushed;	// Time of last flush
+
+	public:
+		SessionLog(std::ostream& streamInput);	// Constructor with log stream, writing the header
+		~SessionLog();	// Destructor, flushing the entries left in the stream
+
+		// Record a command with up to 3 arguments, its signal (-1 if none)
+		// and the resulting state of the microcontroller, unless the
+		// arguments imply it (c, m, b, w and k)
+		void record(const char& command, const Microcontroller * microcontroller,
+				const int& count = 0,
+				const unsigned long long& first = 0,
+				const unsigned long long& second = 0,
+				const unsigned long long& third = 0, const int& signal = -1,
+				const std::string& text = "");
+		// Read and check header of a log, return false if it is not a session log
+		static const bool readHeader(std::istream& stream);
+		// Read next entry, return 1 if read, 0 at the end of the log and -1
+		// if it is truncated or malformed
+		static const int read(std::istream& stream, SessionEntry& entry);
+	};
+}
+
+
+
+#endif /* SRC_SESSIONLOG_H_ */
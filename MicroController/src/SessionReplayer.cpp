@@ -0,0 +1,267 @@
+/*
+ * SessionReplayer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <time.h>
+#include "SessionReplayer.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Get seconds elapsed on a monotonic clock
+	static double now ()
+	{
+		struct timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return time.tv_sec + time.tv_nsec * 1e-9;
+	}
+
+	// Get name of a signal, or "no signal" if it is not one
+	static const std::string signalName (const int& signal)
+	{
+		return signal >= 0 && signal <= Microcontroller::BREAK
+				? Microcontroller::SIGNALS[signal] : "no signal";
+	}
+
+	// Add a log to the batch
+	void SessionReplayer::addLog (const std::string& filename)
+	{
+		Replay replay;
+		replay.filename = filename;
+		replay.entries = 0;
+		replays.push_back(replay);
+	}
+
+	// Replay logs until none is left, taking the next one each time, so
+	// long and short logs balance across workers
+	void SessionReplayer::work ()
+	{
+		int index;
+		while ((index = next.fetch_add(1)) < (int) replays.size())
+		{
+			replay(replays[index]);
+		}
+	}
+
+	// Apply an entry to a microcontroller, return signal raised or -1
+	const int SessionReplayer::apply (const SessionEntry& entry,
+			Microcontroller * microcontroller)
+	{
+		const unsigned long long * arguments = entry.arguments;
+		unsigned long long budget, time;
+		switch (entry.command)
+		{
+			case 'r':
+				microcontroller->initialize();
+				break;
+			case 'm':
+				microcontroller->modify(arguments[0], arguments[1]);
+				break;
+			case 'e':
+				return microcontroller->execute();
+			case 'g':
+				return microcontroller->execute(arguments[0]);
+			case 'n':
+				budget = arguments[0];
+				return microcontroller->run(budget);
+			case 't':
+				budget = 1;
+				return microcontroller->run(budget);
+			case '<':
+			{
+				// A snapshot replaces the whole state, while the text state
+				// of older logs only lists non-zero locations, so it starts
+				// from zeros
+				std::istringstream stream(entry.text);
+				if (!Microcontroller::isSnapshot(stream))
+				{
+					microcontroller->initialize();
+				}
+				microcontroller->loadState(stream);
+				break;
+			}
+			case 'b':
+				microcontroller->addBreakpoint(arguments[0], arguments[0],
+						Microcontroller::BREAKPOINT);
+				break;
+			case 'w':
+				microcontroller->addBreakpoint(arguments[0], arguments[1], arguments[2]);
+				break;
+			case 'k':
+				if (arguments[0])
+				{
+					microcontroller->removeBreakpoint(arguments[0] - 1);
+				}
+				else
+				{
+					microcontroller->clearBreakpoints();
+				}
+				break;
+			case 'z':
+				if (arguments[0] == SessionLog::REVERSE_ON)
+				{
+					microcontroller->startRecording(arguments[1]);
+				}
+				else if (arguments[0] == SessionLog::REVERSE_OFF)
+				{
+					microcontroller->stopRecording();
+				}
+				else if (arguments[0] == SessionLog::REVERSE_BACK)
+				{
+					microcontroller->travelTo(microcontroller->getRecordedTime() - arguments[1]);
+				}
+				else
+				{
+					microcontroller->findLastWrite(arguments[1], time);
+				}
+				break;
+		}
+		return -1;
+	}
+
+	// Replay a single log, stopping at the first outcome differing from
+	// the recorded one
+	void SessionReplayer::replay (Replay& replay) const
+	{
+		std::ifstream stream(replay.filename.c_str(), std::ifstream::binary);
+		if (!stream)
+		{
+			replay.error = "log not found";
+			return;
+		}
+		if (!SessionLog::readHeader(stream))
+		{
+			replay.error = "not a session log";
+			return;
+		}
+
+		Microcontroller * microcontroller = NULL;
+		SessionEntry entry;
+		int status;
+		while ((status = SessionLog::read(stream, entry)) > 0)
+		{
+			replay.entries++;
+			std::ostringstream error;
+
+			// Connect creates a new microcontroller, other commands need one
+			if (entry.command == 'c')
+			{
+				delete microcontroller;
+				microcontroller = factory->createMicrocontroller(entry.text);
+				if (!microcontroller || !microcontroller->setEngine(entry.arguments[0])
+						|| (entry.arguments[1]
+							&& !microcontroller->setMemorySize(entry.arguments[1])))
+				{
+					error << "cannot connect " << entry.text;
+				}
+			}
+			else if (!microcontroller)
+			{
+				error << "no microcontroller connected";
+			}
+			else if (!entry.command || !std::strchr("rmegnt<bwkzq", entry.command))
+			{
+				error << "unknown command";
+			}
+			else
+			{
+				// Apply entry and check its outcome
+				int signal = apply(entry, microcontroller);
+				if (entry.signal >= 0 && signal != entry.signal)
+				{
+					error << signalName(signal) << " instead of "
+						  << signalName(entry.signal);
+				}
+				else if (entry.stated && (microcontroller->getPC() != entry.pc
+						|| microcontroller->digest() != entry.digest))
+				{
+					error << "state differs at PC 0x" << std::hex
+						  << microcontroller->getPC() << " (PC 0x" << entry.pc
+						  << " recorded)";
+				}
+			}
+
+			// Stop at the first mismatch, later ones follow from it
+			if (error.tellp() > 0)
+			{
+				std::ostringstream stream;
+				stream << "entry " << std::dec << replay.entries << " ("
+					   << entry.command << "), " << error.str();
+				replay.error = stream.str();
+				break;
+			}
+		}
+		if (status < 0)
+		{
+			replay.error = "log truncated";
+		}
+
+		delete microcontroller;
+	}
+
+	// Replay all logs, on one thread per core by default
+	void SessionReplayer::run (int threads)
+	{
+		// Size pool to the cores
+		if (threads <= 0)
+		{
+			threads = std::max((int) std::thread::hardware_concurrency(), 1);
+		}
+		threads = std::max(std::min(threads, (int) replays.size()), 1);
+
+		// Start workers, the calling thread being the first of them
+		double start = now();
+		next = 0;
+		std::vector<std::thread> workers;
+		for (int i = 1; i < threads; i++)
+		{
+			workers.push_back(std::thread(&SessionReplayer::work, this));
+		}
+		work();
+		for (int i = 0; i < (int) workers.size(); i++)
+		{
+			workers[i].join();
+		}
+		seconds = now() - start;
+	}
+
+	// Write results and summary, return number of failed logs
+	const int SessionReplayer::report (std::ostream& stream) const
+	{
+		int failed = 0, entries = 0;
+
+		// Write result of each log in batch order
+		for (int i = 0; i < (int) replays.size(); i++)
+		{
+			const Replay& replay = replays[i];
+			stream << replay.filename << ": ";
+			if (replay.error.length())
+			{
+				stream << "FAIL, " << replay.error << '\n';
+				failed++;
+			}
+			else
+			{
+				stream << "PASS, " << std::dec << replay.entries << " entries\n";
+			}
+			entries += replay.entries;
+		}
+
+		// Write summary
+		stream << std::dec << replays.size() << " logs (" << failed << " failed) in "
+			   << seconds << " s: "
+			   << (seconds > 0 ? entries / seconds : 0) << " entries/s" << std::endl;
+		return failed;
+	}
+}
+
+
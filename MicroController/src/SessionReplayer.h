@@ -0,0 +1,59 @@
+/*
+ * SessionReplayer.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_SESSIONREPLAYER_H_
+#define SRC_SESSIONREPLAYER_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include "Microcontroller.h"
+#include "MicrocontrollerFactory.h"
+#include "SessionLog.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Replays session logs on a thread pool through the microcontroller
+	// interface, without parsing commands, checking the recorded signals
+	// and states
+	class SessionReplayer
+	{
+	private:
+		// Log of a batch and its result
+		struct Replay
+		{
+			std::string filename;	// Session log file
+			int entries;	// Number of entries replayed
+			std::string error;	// First mismatch or reason the log could not be replayed, empty if it passed
+		};
+
+		const MicrocontrollerFactory * factory;	// Microcontroller producer
+		std::vector<Replay> replays;	// Logs of the batch
+		std::atomic<int> next;	// Index of the next log to replay
+		double seconds;	// Wall time of the last run
+
+	public:
+		SessionReplayer(const MicrocontrollerFactory * factoryInput) :
+				factory(factoryInput), next(0), seconds(0) {}	// Constructor with factory
+
+	private:
+		void work();	// Replay logs until none is left
+		void replay(Replay& replay) const;	// Replay a single log
+		// Apply an entry to a microcontroller, return signal raised or -1
+		static const int apply(const SessionEntry& entry, Microcontroller * microcontroller);
+
+	public:
+		void addLog(const std::string& filename);	// Add a log to the batch
+		void run(int threads = 0);	// Replay all logs, on one thread per core by default
+		const int report(std::ostream& stream) const;	// Write results and summary, return number of failed logs
+	};
+}
+
+
+
+#endif /* SRC_SESSIONREPLAYER_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Timeline.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "Timeline.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Drop history and start it from the pages of memory pageFlags tell are
+	// touched, a checkpoint being due
+	void Timeline::start (const unsigned char * memory,
+			const unsigned char * pageFlags, const int& size)
+	{
+		checkpoints.clear();
+		bytes = 0;
+		base.clear();
+		baseData.clear();
+		memorySize = size;
+		for (int i = 0; i << Microcontroller::PAGE_SHIFT < size; i++)
+		{
+			if (pageFlags[i] & Microcontroller::PAGE_TOUCHED)
+			{
+				int start = i << Microcontroller::PAGE_SHIFT;
+				base[i] = baseData.size();
+				baseData.insert(baseData.end(), memory + start, memory
+						+ std::min(start + (1 << Microcontroller::PAGE_SHIFT), size));
+			}
+		}
+		valid = true;
+		due = true;
+	}
+
+	// Drop history, as it no longer leads to the current state
+	void Timeline::invalidate ()
+	{
+		checkpoints.clear();
+		bytes = 0;
+		std::unordered_map<int, size_t>().swap(base);
+		std::vector<unsigned char>().swap(baseData);
+		valid = false;
+	}
+
+	// Append a checkpoint, taking its pages, and fold the oldest ones into
+	// the base pages while over the limit
+	void Timeline::add (Checkpoint& checkpoint)
+	{
+		checkpoints.push_back(Checkpoint());
+		std::swap(checkpoints.back(), checkpoint);
+		bytes += checkpoints.back().data.size();
+		due = false;
+
+		// The second oldest checkpoint becomes the oldest, its pages
+		// replacing or joining the base pages
+		while (bytes > limit && checkpoints.size() > 1)
+		{
+			Checkpoint& next = checkpoints[1];
+			for (int i = 0, offset = 0; i < (int) next.pages.size(); i++)
+			{
+				int length = pageLength(next.pages[i]);
+				std::unordered_map<int, size_t>::iterator found = base.find(next.pages[i]);
+				if (found != base.end())
+				{
+					std::memcpy(&baseData[found->second], &next.data[offset], length);
+				}
+				else
+				{
+					base[next.pages[i]] = baseData.size();
+					baseData.insert(baseData.end(), &next.data[offset], &next.data[offset] + length);
+				}
+				offset += length;
+			}
+			bytes -= next.data.size();
+			std::vector<int>().swap(next.pages);
+			std::vector<unsigned char>().swap(next.data);
+			checkpoints.pop_front();
+		}
+	}
+
+	// Find latest checkpoint at or before a time, return -1 if none
+	const int Timeline::find (const unsigned long long& at) const
+	{
+		for (int i = checkpoints.size() - 1; i >= 0; i--)
+		{
+			if (checkpoints[i].time <= at)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Drop checkpoints after an index
+	void Timeline::truncate (const int& index)
+	{
+		while ((int) checkpoints.size() > index + 1)
+		{
+			bytes -= checkpoints.back().data.size();
+			checkpoints.pop_back();
+		}
+	}
+
+	// Add pages written after the oldest checkpoint to pages, then map each
+	// one to its content at a checkpoint, NULL if untouched then. Other
+	// pages are the same at every checkpoint, so a restore only visits the
+	// pages recorded, whatever the memory size
+	void Timeline::contentAt (const int& index,
+			std::unordered_map<int, const unsigned char *>& pages) const
+	{
+		for (int i = 1; i < (int) checkpoints.size(); i++)
+		{
+			for (int j = 0; j < (int) checkpoints[i].pages.size(); j++)
+			{
+				pages.emplace(checkpoints[i].pages[j], (const unsigned char *) NULL);
+			}
+		}
+
+		// Start from the base pages, then apply the pages of every
+		// checkpoint up to index
+		std::unordered_map<int, const unsigned char *>::iterator page;
+		for (page = pages.begin(); page != pages.end(); ++page)
+		{
+			std::unordered_map<int, size_t>::const_iterator found = base.find(page->first);
+			page->second = found != base.end() ? &baseData[found->second] : NULL;
+		}
+		for (int i = 1; i <= index; i++)
+		{
+			const Checkpoint& checkpoint = checkpoints[i];
+			for (int j = 0, offset = 0; j < (int) checkpoint.pages.size(); j++)
+			{
+				pages[checkpoint.pages[j]] = &checkpoint.data[offset];
+				offset += pageLength(checkpoint.pages[j]);
+			}
+		}
+	}
+}
+
+
@@ -0,0 +1,98 @@
+/*
+ * Timeline.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_TIMELINE_H_
+#define SRC_TIMELINE_H_
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstddef>
+#include <algorithm>
+#include "Microcontroller.h"
+
+namespace MicrocontrollerEmulation
+{
+	// State of execution at a point in time, memory being given by the pages
+	// written since the previous checkpoint
+	struct Checkpoint
+	{
+		unsigned long long time;	// Instructions executed since recording started
+		int pc;	// Program Counter
+		unsigned char registers[Microcontroller::MAX_REGISTERS];	// Register bytes
+		std::vector<int> pages;	// Pages written since the previous checkpoint
+		std::vector<unsigned char> data;	// Content of those pages, one after the other
+	};
+
+	// Checkpoints taken while executing, oldest first, with the touched pages
+	// of memory at the oldest one. Once the pages of the checkpoints exceed a
+	// limit, the oldest ones are folded into these base pages, so memory use
+	// is bounded and only the earliest history is lost
+	class Timeline
+	{
+	private:
+		std::deque<Checkpoint> checkpoints;	// Checkpoints, oldest first
+		std::unordered_map<int, size_t> base;	// Offset in baseData of each page touched at the oldest checkpoint
+		std::vector<unsigned char> baseData;	// Content of those pages, untouched pages being 0
+		size_t bytes;	// Bytes of pages held by checkpoints
+		size_t limit;	// Bytes of pages held at most
+		int memorySize;	// Size of memory recorded
+		unsigned long long interval;	// Instructions between periodic checkpoints
+		unsigned long long time;	// Instructions executed since recording started
+		bool valid;	// Whether the history leads to the current state
+		bool due;	// Whether a checkpoint must be taken before executing again
+
+		// Get length of a page, the last one being cut at the end of memory
+		const int pageLength(const int& page) const
+		{
+			return std::min(1 << Microcontroller::PAGE_SHIFT,
+					memorySize - (page << Microcontroller::PAGE_SHIFT));
+		}
+
+	public:
+		Timeline(const unsigned long long& intervalInput, const size_t& limitInput) :
+				bytes(0), limit(limitInput), memorySize(0), interval(intervalInput), time(0),
+				valid(false), due(false) {}	// Constructor with checkpoint interval and limit of bytes held
+
+		// Drop history and start it from the pages of memory pageFlags tell
+		// are touched, a checkpoint being due
+		void start(const unsigned char * memory, const unsigned char * pageFlags,
+				const int& size);
+		// Append a checkpoint, taking its pages, and fold the oldest ones
+		// into the base pages while over the limit
+		void add(Checkpoint& checkpoint);
+		// Find latest checkpoint at or before a time, return -1 if none
+		const int find(const unsigned long long& at) const;
+		// Drop checkpoints after an index
+		void truncate(const int& index);
+		// Add pages written after the oldest checkpoint to pages, then map
+		// each one to its content at a checkpoint, NULL if untouched then
+		void contentAt(const int& index, std::unordered_map<int, const unsigned char *>& pages) const;
+
+		const Checkpoint& get(const int& index) const { return checkpoints[index]; }	// Get checkpoint by index, oldest first
+		const int getCount() const { return checkpoints.size(); }	// Get number of checkpoints
+		const size_t getBytes() const { return bytes + baseData.size(); }	// Get bytes held by pages of checkpoints and base pages
+		const unsigned long long getInterval() const { return interval; }	// Get instructions between periodic checkpoints
+		const unsigned long long getTime() const { return time; }	// Get instructions executed since recording started
+		void setTime(const unsigned long long& at) { time = at; }	// Set instructions executed since recording started
+		const unsigned long long getOldestTime() const {
+			return checkpoints.empty() ? time : checkpoints.front().time;
+		}	// Get time of the oldest checkpoint, the earliest time recorded
+		const unsigned long long untilCheckpoint() const {
+			return interval - time % interval;
+		}	// Get instructions until the next periodic checkpoint
+		const bool isValid() const { return valid; }	// Check if the history leads to the current state
+		// Drop history, as it no longer leads to the current state
+		void invalidate();
+		const bool isCheckpointDue() const { return due; }	// Check if a checkpoint must be taken before executing again
+		void setCheckpointDue(const bool& dueInput) { due = dueInput; }	// Set whether a checkpoint must be taken before executing again
+	};
+}
+
+
+
+#endif /* SRC_TIMELINE_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Tracer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "Tracer.h"
+
+namespace MicrocontrollerEmulation
+{
+	// Initialize trace file magic and version
+	const char Tracer::TRACE_MAGIC[4] = {'M', 'C', 'T', 'R'};
+	const unsigned short Tracer::TRACE_VERSION = 1;
+
+	// Constructor with minimum number of records kept
+	Tracer::Tracer (const unsigned int& capacity) : count(0)
+	{
+		// Round capacity up to a power of two, so slots are found by masking
+		unsigned int size = 1;
+		while (size < capacity && size < 0x80000000U)
+		{
+			size <<= 1;
+		}
+
+		records.resize(size);
+		mask = size - 1;
+	}
+
+	// Write header and records kept to stream
+	const bool Tracer::dump (std::ostream& stream, const std::string& type,
+			const int& registerCount) const
+	{
+		// Fill header
+		TraceHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+		header.version = TRACE_VERSION;
+		header.recordSize = sizeof(TraceRecord);
+		type.copy(header.type, sizeof(header.type) - 1);
+		header.count = count;
+		header.stored = (unsigned int) std::min(count, (unsigned long long) records.size());
+		header.registerCount = registerCount;
+
+		// Write header, then records from the oldest kept, which is the
+		// next slot once the ring has wrapped
+		stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		unsigned int first = count > records.size() ? count & mask : 0;
+		unsigned int tail = std::min(header.stored, (unsigned int) records.size() - first);
+		stream.write(reinterpret_cast<const char *>(&records[first]),
+				tail * sizeof(TraceRecord));
+		stream.write(reinterpret_cast<const char *>(&records[0]),
+				(header.stored - tail) * sizeof(TraceRecord));
+
+		return (bool) stream;
+	}
+
+	// Read header and records from stream
+	const bool Tracer::load (std::istream& stream, TraceHeader& header,
+			std::vector<TraceRecord>& loaded)
+	{
+		// Read and check header
+		if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header))
+				|| std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic))
+				|| header.version != TRACE_VERSION
+				|| header.recordSize != sizeof(TraceRecord))
+		{
+			return false;
+		}
+		header.type[sizeof(header.type) - 1] = '\0';
+
+		// Check the records stored fit in the bytes left, before allocating them
+		std::streampos start = stream.tellg();
+		if (start < 0 || !stream.seekg(0, std::ios::end))
+		{
+			return false;
+		}
+		unsigned long long left = (unsigned long long) (stream.tellg() - start);
+		if (!stream.seekg(start)
+				|| (unsigned long long) header.stored * sizeof(TraceRecord) > left)
+		{
+			return false;
+		}
+
+		// Read records
+		loaded.resize(header.stored);
+		return header.stored == 0 || (bool) stream.read(reinterpret_cast<char *>(&loaded[0]),
+				header.stored * sizeof(TraceRecord));
+	}
+}
+
+
@@ -0,0 +1,71 @@
+/*
+ * Tracer.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#ifndef SRC_TRACER_H_
+#define SRC_TRACER_H_
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace MicrocontrollerEmulation
+{
+	// Record of one executed instruction (fields are in host byte order)
+	struct TraceRecord
+	{
+		int pc;	// PC of the instruction
+		int address;	// Memory location written, -1 if none
+		unsigned char opcode;	// Opcode
+		unsigned char operands[3];	// Bytes following the opcode
+		unsigned char registerW;	// First register byte after the instruction (W), 0 if none
+		unsigned char value;	// Value written
+		unsigned char signal;	// Signal raised by the instruction
+		unsigned char reserved;	// Zero padding
+	};
+
+	// Header of a trace file, followed by its records from oldest to newest
+	struct TraceHeader
+	{
+		char magic[4];	// TRACE_MAGIC
+		unsigned short version;	// TRACE_VERSION
+		unsigned short recordSize;	// Size of a record
+		char type[16];	// Microcontroller type, zero-padded
+		unsigned long long count;	// Records written in total, older ones being overwritten
+		unsigned int stored;	// Number of records in the file
+		unsigned int registerCount;	// Number of register bytes of the microcontroller
+	};
+
+	// Fixed-size ring buffer of execution records, the newest overwriting the oldest
+	class Tracer
+	{
+	private:
+		std::vector<TraceRecord> records;	// Ring buffer, its size is a power of two
+		unsigned int mask;	// Size of ring buffer - 1
+		unsigned long long count;	// Records written in total
+
+	public:
+		static const char TRACE_MAGIC[4];	// Leading bytes of trace files
+		static const unsigned short TRACE_VERSION;	// Version of trace file format
+
+		Tracer(const unsigned int& capacity);	// Constructor with minimum number of records kept
+
+		// Take slot of the next record
+		TraceRecord& next() { return records[count++ & mask]; }
+
+		void reset() { count = 0; }	// Drop all records
+		const unsigned long long getCount() const { return count; }	// Get records written in total
+		const unsigned int getCapacity() const { return mask + 1; }	// Get number of records kept
+		const bool dump(std::ostream& stream, const std::string& type,
+				const int& registerCount) const;	// Write header and records kept to stream
+		static const bool load(std::istream& stream, TraceHeader& header,
+				std::vector<TraceRecord>& loaded);	// Read header and records from a seekable stream, false if they do not fit in it
+	};
+}
+
+
+
+#endif /* SRC_TRACER_H_ */
@@ -5,25 +5,113 @@
  *      Author: huy
  */
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <cctype>
+#include <cstdlib>
 #include "utility.h"
 #include "Microcontroller.h"
 #include "MicrocontrollerFactory.h"
+#include "ScriptRunner.h"
+#include "SessionLog.h"
+#include "SessionReplayer.h"
 
 
 using namespace MicrocontrollerEmulation;
 
-int main() {
+int main(int argc, char * argv[]) {
+	// Register plug-in modules of the plug-in directory next to the
+	// executable, overridden by the environment variable
+	MicrocontrollerFactory::loadPlugins(MicrocontrollerFactory::getPluginDirectory());
+
 	// Microcontroller Factory and Microcontroller pointer
 	MicrocontrollerFactory * factory = new MicrocontrollerFactory();
 	Microcontroller * microcontroller = NULL;
 
+	// -v replays session logs on all cores and checks their outcomes,
+	// failing if any differs
+	if (argc > 2 && std::string(argv[1]) == "-v") {
+		SessionReplayer replayer(factory);
+		for (int i = 2; i < argc; i++) {
+			replayer.addLog(argv[i]);
+		}
+		replayer.run();
+		int failed = replayer.report(std::cout);
+		delete factory;
+		return failed ? 1 : 0;
+	}
+
+	// -r records the session to a log, any other argument selects batch
+	// mode: [-q] [script], script '-' or none being standard input
+	bool batch = false, quiet = false;
+	std::string script = "-", record;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "-r" && i + 1 < argc && !record.length()) {
+			record = argv[++i];
+		} else if (argument == "-q") {
+			quiet = true;
+			batch = true;
+		} else if (argument == "-" || argument[0] != '-') {
+			script = argument;
+			batch = true;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [-r log] [-q] [script]\n"
+					<< "       " << argv[0] << " -v log...\n"
+					<< "Runs a command script ('-' for standard input) without\n"
+					<< "prompts or echo. -q only writes errors and the output of\n"
+					<< "b, d, f, h, l, o, p, s, u and w commands. -r records\n"
+					<< "commands changing the microcontroller and their outcomes to\n"
+					<< "a session log, in batch or interactive mode. -v replays\n"
+					<< "session logs on all cores and checks the outcomes." << std::endl;
+			return 1;
+		}
+	}
+
+	// Open session log if requested
+	std::ofstream logStream;
+	SessionLog * session = NULL;
+	if (record.length()) {
+		logStream.open(record.c_str(),
+				std::ios::out | std::ios::trunc | std::ios::binary);
+		if (!logStream) {
+			std::cerr << "Session log cannot be created: " << record << std::endl;
+			return 1;
+		}
+		session = new SessionLog(logStream);
+		setSessionLog(session);
+	}
+
+	// Run script in batch mode
+	if (batch) {
+		std::ifstream fstream;
+		if (script != "-") {
+			fstream.open(script.c_str(), std::ios::in | std::ios::binary);
+			if (!fstream) {
+				std::cerr << "Script not found: " << script << std::endl;
+				return 1;
+			}
+		}
+		ScriptRunner runner(factory, quiet);
+		int invalid = runner.run(script != "-" ? fstream : std::cin,
+				microcontroller);
+
+		// Record final state, then terminate program, failing if any
+		// command was invalid
+		if (session && microcontroller) {
+			session->record('q', microcontroller);
+		}
+		delete session;
+		delete microcontroller;
+		delete factory;
+		return invalid ? 1 : 0;
+	}
+
 	// Display greeting
 	std::cout << "Welcome to Microcontroller Emulator!\n"
 			<< "Type 'h' if you need help" << std::endl;
 
-	// Get validated command and utilize
+	// Get validated command and utilize, until Quit or end of input
 	std::string commandLine;
 	do {
 		// Get command line and create input string stream
@@ -33,7 +121,14 @@ int main() {
 		if (commandLine.length()) {
 			utilize(commandLine, factory, microcontroller);
 		}
-	} while (!(commandLine.length() && tolower(commandLine[0]) == 'q'));
+	} while (!(commandLine.length() && tolower(commandLine[0]) == 'q')
+			&& std::cin);
+
+	// Record final state
+	if (session && microcontroller) {
+		session->record('q', microcontroller);
+	}
+	delete session;
 
 	// Display farewell
 	std::cout << "Thanks for using Microcontroller Emulator!\n"
@@ -42,4 +137,3 @@ int main() {
 	// Terminate program
 	return 0;
 }
-
@@ -8,9 +8,11 @@
 #include "utility.h"
 #include "Microcontroller.h"
 #include "MicrocontrollerFactory.h"
+#include "FleetRunner.h"
 #include <iostream>
 #include <string>
 #include <cctype>
+#include <cstdlib>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
@@ -18,6 +20,21 @@
 
 namespace MicrocontrollerEmulation
 {
+	// Session log commands are recorded to, NULL if none
+	static SessionLog * sessionLog = NULL;
+
+	// Record commands changing the microcontroller to a session log, NULL to stop
+	void setSessionLog (SessionLog * log)
+	{
+		sessionLog = log;
+	}
+
+	// Get session log commands are recorded to, NULL if none
+	SessionLog * getSessionLog ()
+	{
+		return sessionLog;
+	}
+
 	// Function to get command from user
 	const std::string getCommand ()
 	{
@@ -63,11 +80,11 @@ namespace MicrocontrollerEmulation
 			// Get command character (lower-cased)
 			char command = tolower(input[0]);
 
-			// Check for Load, Save, Display, Execute,
-			// Help, Reset, Status and Quit commands
-			if (command == '<' || command == '>' || command == 'd'
+			// Check for Load, Execute, Help, Reset, Status, Step and Quit
+			// commands
+			if (command == '<'
 					|| command == 'e' || command == 'h' || command == 'r'
-					|| command == 's' || command == 'q')
+					|| command == 's' || command == 't' || command == 'q')
 			{
 				// If input is not single-character, return failure
 				if (input.length() > 1)
@@ -75,10 +92,17 @@ namespace MicrocontrollerEmulation
 					return false;
 				}
 			}
-			else if (command == 'c' || command == 'g' || command == 'l'
-						|| command == 'm')
+			else if (command == '>' || command == 'b' || command == 'c'
+						|| command == 'd' || command == 'f' || command == 'g'
+						|| command == 'i' || command == 'k' || command == 'l'
+						|| command == 'm' || command == 'n' || command == 'o'
+						|| command == 'p' || command == 'u' || command == 'v'
+						|| command == 'w' || command == 'x' || command == 'z')
 			{
-				// Check for Connect, Go, Look and Modify commands
+				// Check for Save, Breakpoint, Connect, Display, Fleet, Go,
+				// Instrumentation, Kill breakpoint, Look, Modify, Run, Search,
+				// Profile, Compare, Video, Watchpoint, Trace and Reverse
+				// commands
 
 				// If input is single-character, validate parameter(s)
 				if (input.length() > 1)
@@ -126,12 +150,17 @@ namespace MicrocontrollerEmulation
 					std::istringstream stream(input);
 					stream.ignore(2);
 
-					// If number of spaces is 1 and command is not of the
-					// first 3, or number of spaces is 2 and command is
-					// not of the last one, return failure
-					if ((spaces == 1 &&	!(command == 'c'
-							|| command == 'g' || command == 'l'))
-						|| (spaces == 2 && command != 'm') || spaces > 2)
+					// If number of spaces is 1 and command is Modify, or
+					// number of spaces is 2 and command is not Connect,
+					// Display, Modify, Search, Watchpoint or Reverse, or
+					// number of spaces is 3 and command is not Connect or
+					// Watchpoint, return failure
+					if ((spaces == 1 && command == 'm')
+						|| (spaces == 2 && !(command == 'c' || command == 'd'
+							|| command == 'm' || command == 'o' || command == 'w'
+							|| command == 'z'))
+						|| (spaces == 3 && !(command == 'c' || command == 'w'))
+						|| spaces > 3)
 					{
 						return false;
 					}
@@ -224,8 +253,9 @@ namespace MicrocontrollerEmulation
 		int invalid = 0, lastSpacePosition;
 
 		// Loop through command line to find invalid character
-		for (int i = 1, spaces = 0; (command == 'g'
-					|| command == 'l' || command == 'm')
+		for (int i = 1, spaces = 0; (command == 'b' || command == 'd'
+					|| command == 'g' || command == 'k' || command == 'l'
+					|| command == 'm' || command == 'n')
 					&& !invalid	&& i < (int) commandLine.length(); i++)
 		{
 			// If space detected, increment space counter
@@ -253,9 +283,9 @@ namespace MicrocontrollerEmulation
 			}
 		}
 
-		// If command is not Connect, Help and Quit and microcontroller
+		// If command is not Connect, Fleet, Help and Quit and microcontroller
 		// is not connected, display error message
-		if (!(command == 'c' || command == 'h'
+		if (!(command == 'c' || command == 'f' || command == 'h'
 				|| command == 'q' || microcontroller))
 		{
 			std::cerr << "Microcontroller not found! "
@@ -270,18 +300,63 @@ namespace MicrocontrollerEmulation
 					load(microcontroller);
 					break;
 				case '>':
-					save(microcontroller);
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string format;
+						stream >> format;
+
+						// Call parameterized function
+						save(microcontroller, format);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						save(microcontroller);
+					}
+					break;
+				case 'b':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// If invalid character found,
+						// set negative (invalid) value for parameter(s)
+						if (invalid)
+						{
+							breakpoint(microcontroller, true, -1);
+						}
+						else
+						{
+							// Else, get validated parameter(s)
+							// and call function
+
+							// Get parameter(s)
+							int location;
+							stream >> std::hex
+								   >> std::setw(commandLine.length() - 2)
+								   >> location;
+
+							// Call parameterized function
+							breakpoint(microcontroller, true, location);
+						}
+					}
+					else
+					{
+						// Else, call function with no parameter
+						breakpoint(microcontroller);
+					}
 					break;
 				case 'c':
 					// Insert parameter(s) if existed
 					if (commandLine.length() > 1)
 					{
 						// Get parameter(s)
-						std::string type;
-						stream >> type;
+						std::string type, engine, size;
+						stream >> type >> engine >> size;
 
 						// Call parameterized function
-						microcontroller = connect(factory, type);
+						microcontroller = connect(factory, type, engine, size);
 					}
 					else
 					{
@@ -290,7 +365,62 @@ namespace MicrocontrollerEmulation
 					}
 					break;
 				case 'd':
-					display(microcontroller);
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// If invalid character found,
+						// set negative (invalid) value for parameter(s)
+						if (invalid == 1)
+						{
+							display(microcontroller, true, -1, 0);
+						}
+						else if (invalid == 2)
+						{
+							display(microcontroller, true, 0, -1);
+						}
+						else
+						{
+							// Else, get validated parameter(s)
+							// and call function
+
+							// Get parameter(s), the end defaulting to the
+							// end of memory
+							int start;
+							int end = microcontroller->getMemorySize() - 1;
+							stream >> std::hex
+								   >> std::setw(commandLine.length() - 2)
+								   >> start;
+							if (commandLine.find(' ', 2) != std::string::npos)
+							{
+								stream >> end;
+							}
+
+							// Call parameterized function
+							display(microcontroller, true, start, end);
+						}
+					}
+					else
+					{
+						// Else, call function with no parameter
+						display(microcontroller);
+					}
+					break;
+				case 'f':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string filename;
+						stream >> filename;
+
+						// Call parameterized function
+						fleet(factory, filename);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						fleet(factory);
+					}
 					break;
 				case 'e':
 					execute(microcontroller);
@@ -329,6 +459,37 @@ namespace MicrocontrollerEmulation
 				case 'h':
 					displayMenu();
 					break;
+				case 'k':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// If invalid character found,
+						// set negative (invalid) value for parameter(s)
+						if (invalid)
+						{
+							removeBreakpoint(microcontroller, true, -1);
+						}
+						else
+						{
+							// Else, get validated parameter(s)
+							// and call function
+
+							// Get parameter(s)
+							int number;
+							stream >> std::hex
+								   >> std::setw(commandLine.length() - 2)
+								   >> number;
+
+							// Call parameterized function
+							removeBreakpoint(microcontroller, true, number);
+						}
+					}
+					else
+					{
+						// Else, call function with no parameter
+						removeBreakpoint(microcontroller);
+					}
+					break;
 				case 'l':
 					// Insert parameter(s) if existed
 					if (commandLine.length() > 1)
@@ -360,6 +521,23 @@ namespace MicrocontrollerEmulation
 						look(microcontroller);
 					}
 					break;
+				case 'i':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string mode;
+						stream >> mode;
+
+						// Call parameterized function
+						instrument(microcontroller, true, mode);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						instrument(microcontroller);
+					}
+					break;
 				case 'm':
 					// Insert parameter(s) if existed
 					if (commandLine.length() > 1)
@@ -396,12 +574,175 @@ namespace MicrocontrollerEmulation
 						modify(microcontroller);
 					}
 					break;
+				case 'n':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// If invalid character found,
+						// set negative (invalid) value for parameter(s)
+						if (invalid)
+						{
+							run(microcontroller, true, -1);
+						}
+						else
+						{
+							// Else, get validated parameter(s)
+							// and call function
+
+							// Get parameter(s)
+							int count;
+							stream >> std::hex
+								   >> std::setw(commandLine.length() - 2)
+								   >> count;
+
+							// Call parameterized function
+							run(microcontroller, true, count);
+						}
+					}
+					else
+					{
+						// Else, call function with no parameter
+						run(microcontroller);
+					}
+					break;
+				case 'o':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string pattern;
+						std::string mask;
+						stream >> pattern >> mask;
+
+						// Call parameterized function
+						search(microcontroller, pattern, mask);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						search(microcontroller);
+					}
+					break;
+				case 'p':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string mode;
+						stream >> mode;
+
+						// Call parameterized function
+						profile(microcontroller, true, mode);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						profile(microcontroller);
+					}
+					break;
 				case 'r':
 					reset(microcontroller);
 					break;
 				case 's':
 					status(microcontroller);
 					break;
+				case 't':
+					step(microcontroller);
+					break;
+				case 'u':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string filename;
+						stream >> filename;
+
+						// Call parameterized function
+						compare(factory, microcontroller, filename);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						compare(factory, microcontroller);
+					}
+					break;
+				case 'v':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string rate;
+						stream >> rate;
+
+						// Call parameterized function
+						video(microcontroller, true, rate);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						video(microcontroller);
+					}
+					break;
+				case 'w':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string start;
+						std::string end;
+						std::string mode;
+						stream >> start >> end >> mode;
+
+						// Call parameterized function
+						watch(microcontroller, start, end, mode);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						watch(microcontroller);
+					}
+					break;
+				case 'x':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string mode;
+						stream >> mode;
+
+						// Call parameterized function
+						trace(microcontroller, true, mode);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						trace(microcontroller);
+					}
+					break;
+				case 'z':
+					// Insert parameter(s) if existed
+					if (commandLine.length() > 1)
+					{
+						// Get parameter(s)
+						std::string mode;
+						std::string value;
+						stream >> mode >> value;
+
+						// Call parameterized function
+						reverse(microcontroller, true, mode, value);
+					}
+					else
+					{
+						// Else, call function with no parameter
+						reverse(microcontroller);
+					}
+					break;
+			}
+
+			// Present output written by the command, e.g. the screen
+			if (microcontroller)
+			{
+				microcontroller->present();
 			}
 		}
 	}
@@ -426,60 +767,144 @@ namespace MicrocontrollerEmulation
 			case Microcontroller::HALT:
 				std::cout << "Program halted" << std::endl;
 				break;
+			case Microcontroller::BREAK:
+				std::cout << microcontroller->breakString() << std::endl;
+				break;
+			case Microcontroller::BUDGET_EXHAUSTED:
+				std::cout << "Instruction budget exhausted. Program Counter = 0x"
+						  << std::hex << std::setw(2) << std::setfill('0')
+						  << microcontroller->getPC()
+						  << std::endl;
+				break;
 		}
 	}
 
 	// Load microcontroller state
 	void load (Microcontroller * microcontroller)
 	{
-		// Create output string stream to build filename
-		std::string filename = "save." + toLower(microcontroller->getType());
-
-		// Open file for reading
-		std::ifstream fstream(filename.c_str());
-
-		// If file exists, read from file
-		if (fstream)
+		// Load state from the saved slot of the microcontroller type
+		int deltas;
+		int status = loadSlot(microcontroller,
+				"save." + toLower(microcontroller->getType()), deltas);
+
+		// Record state loaded as an untracked binary snapshot, so replays
+		// do not depend on the slot and deltas still chain to it
+		if (sessionLog && status != SLOT_NOT_FOUND)
 		{
-			// Pass file stream to microcontroller and check for status
-			int status = microcontroller->setState(fstream);
-
-			// If state not loaded, display error message
-			if (status)
-			{
-				std::cout << "Unknown state at line " << status
-						  << std::endl;
-			}
-			else
-			{
-				// Else, display success message
-				std::cerr << "Loaded successfully" << std::endl;
-			}
-
-			// Close file
-			fstream.close();
+			std::ostringstream snapshot;
+			microcontroller->getSnapshot(snapshot, false, false);
+			sessionLog->record('<', microcontroller, 0, 0, 0, 0, -1, snapshot.str());
 		}
-		else
+
+		// If state not loaded, display error message
+		if (status == SLOT_NOT_FOUND)
 		{
-			// Else, display error message
 			std::cerr << "Saved slot not found!" << std::endl;
 		}
+		else if (status < 0)
+		{
+			std::cout << "Invalid snapshot" << std::endl;
+		}
+		else if (status)
+		{
+			std::cout << "Unknown state at line " << status
+					  << std::endl;
+		}
+		else
+		{
+			// Else, display success message
+			std::cerr << "Loaded successfully";
+			if (deltas)
+			{
+				std::cerr << " (" << std::dec << deltas << " deltas)";
+			}
+			std::cerr << std::endl;
+		}
+	}
+
+	// Load state from a file, then the deltas chained to it
+	const int loadSlot (Microcontroller * microcontroller,
+			const std::string& filename, int& deltas)
+	{
+		deltas = 0;
+
+		// Open file for reading
+		std::ifstream fstream(filename.c_str(), std::ifstream::binary);
+
+		// If file does not exist, return failure
+		if (!fstream)
+		{
+			return SLOT_NOT_FOUND;
+		}
+
+		// Pass file stream to microcontroller, which detects binary
+		// snapshots and text states, and check for status
+		int status = microcontroller->loadState(fstream);
+
+		// If state loaded, apply deltas chained to the loaded snapshot,
+		// until one is missing or belongs to another chain
+		while (!status && microcontroller->hasSnapshot())
+		{
+			std::ostringstream sstream;
+			sstream << filename << '.' << deltas + 1;
+			std::ifstream dstream(sstream.str().c_str(), std::ifstream::binary);
+			if (!dstream || microcontroller->setSnapshot(dstream))
+			{
+				break;
+			}
+			deltas++;
+		}
+
+		return status;
 	}
 
 	// Save microcontroller state
-	void save (const Microcontroller * microcontroller)
+	void save (Microcontroller * microcontroller, const std::string& format)
 	{
-		// Create output string stream to build filename
-		std::string filename = "save." + toLower(microcontroller->getType());
+		// Format input, binary snapshot by default
+		std::string formatInput = toUpper(format);
+
+		// If format is unknown, display error message
+		if (formatInput.length() && formatInput != "BINARY"
+				&& formatInput != "DELTA" && formatInput != "TEXT")
+		{
+			std::cerr << "Invalid format" << std::endl;
+			return;
+		}
+
+		// If there is no snapshot to chain a delta to, display error message
+		if (formatInput == "DELTA" && !microcontroller->hasSnapshot())
+		{
+			std::cerr << "No snapshot to chain delta to!" << std::endl;
+			return;
+		}
+
+		// Create output string stream to build filename, a delta being
+		// numbered after its position in the chain
+		std::ostringstream sstream;
+		sstream << "save." << toLower(microcontroller->getType());
+		if (formatInput == "DELTA")
+		{
+			sstream << '.' << std::dec << microcontroller->getSnapshotDepth() + 1;
+		}
+		std::string filename = sstream.str();
 
 		// Open file for writing
-		std::ofstream fstream(filename.c_str(), std::ofstream::trunc);
+		std::ofstream fstream(filename.c_str(),
+				std::ofstream::trunc | std::ofstream::binary);
 
 		// If file exists, write to file
 		if (fstream)
 		{
-			// Write to stream
-			fstream << microcontroller->getState();
+			// Write to stream in requested format
+			if (formatInput == "TEXT")
+			{
+				fstream << microcontroller->getState();
+			}
+			else
+			{
+				microcontroller->getSnapshot(fstream, formatInput == "DELTA");
+			}
 
 			// Display success message
 			std::cout << "Saved successfully" << std::endl;
@@ -495,7 +920,8 @@ namespace MicrocontrollerEmulation
 	}
 
 	// Connect to microcontroller
-	Microcontroller * connect (const MicrocontrollerFactory * factory, const std::string& type)
+	Microcontroller * connect (const MicrocontrollerFactory * factory, const std::string& type,
+			const std::string& engine, const std::string& size)
 	{
 		// Type input
 		std::string typeInput = "";
@@ -511,11 +937,11 @@ namespace MicrocontrollerEmulation
 			// Else, get microcontroller type from user
 
 			// Prompt user for a type
-			std::cout << "Please type in one of these microcontroller types:\n"
-					  << MicrocontrollerFactory::TYPES[0];
-			for (int i = 1; i < MicrocontrollerFactory::numberOfTypes(); i++)
+			const std::vector<std::string>& types = MicrocontrollerFactory::getTypes();
+			std::cout << "Please type in one of these microcontroller types:\n";
+			for (size_t i = 0; i < types.size(); i++)
 			{
-				std::cout << ", " << MicrocontrollerFactory::TYPES[i];
+				std::cout << (i ? ", " : "") << types[i];
 			}
 			std::cout << ".\n"
 					  << "> type? ";
@@ -529,10 +955,41 @@ namespace MicrocontrollerEmulation
 		Microcontroller * microcontroller =
 			factory->createMicrocontroller(typeInput);
 
+		// If an engine is requested, switch microcontroller to it
+		if (microcontroller && engine.length()
+				&& !microcontroller->setEngine(
+						Microcontroller::findEngine(toUpper(engine))))
+		{
+			// If engine is unknown or not supported, display error
+			std::cerr << "Invalid engine for " << typeInput << std::endl;
+			delete microcontroller;
+			return NULL;
+		}
+
+		// If a memory size is requested (hexadecimal), resize memory to it
+		if (microcontroller && size.length())
+		{
+			char * end;
+			long bytes = strtol(size.c_str(), &end, 16);
+			if (*end || bytes <= 0 || bytes > Microcontroller::MAX_MEMORY_SIZE
+					|| !microcontroller->setMemorySize(bytes))
+			{
+				// If size is malformed or not supported, display error
+				std::cerr << "Invalid memory size for " << typeInput << std::endl;
+				delete microcontroller;
+				return NULL;
+			}
+		}
+
 		// If microcontroller is created, display success message
 		if (microcontroller)
 		{
 			std::cout << typeInput << " selected" << std::endl;
+			if (sessionLog)
+			{
+				sessionLog->record('c', microcontroller, 2, microcontroller->getEngine(),
+						microcontroller->getMemorySize(), 0, -1, typeInput);
+			}
 
 			// Initialize microcontroller
 			reset(microcontroller);
@@ -547,45 +1004,206 @@ namespace MicrocontrollerEmulation
 		return microcontroller;
 	}
 
-	// Display all memory
-	void display (const Microcontroller * microcontroller)
+	// Run a batch of jobs on all cores
+	void fleet (const MicrocontrollerFactory * factory, const std::string& filename)
 	{
-		// Display column header
-		std::cout << "    ";
-		for (int i = 0; i < 0x10; i++)
+		// Filename input
+		std::string filenameInput = filename;
+
+		// If filename is not provided, get it from user
+		if (!filenameInput.length())
+		{
+			std::cout << "> file? ";
+			getline(std::cin, filenameInput);
+		}
+
+		// Open file for reading
+		std::ifstream fstream(filenameInput.c_str());
+
+		// If file exists, load and run jobs
+		if (fstream)
 		{
-			// Separate display by byte
-			if (i == 0 || i == 8)
+			// Pass file stream to fleet runner and check for status
+			FleetRunner runner(factory);
+			int status = runner.loadJobs(fstream);
+
+			// If jobs not loaded, display error message
+			if (status)
+			{
+				std::cerr << "Invalid job at line " << std::dec << status
+						  << std::endl;
+			}
+			else
 			{
-				std::cout << ' ';
+				// Else, run jobs and display results
+				runner.run();
+				runner.report(std::cout);
 			}
 
-			std::cout << std::hex
-					  << " 0" << i;
+			// Close file
+			fstream.close();
+		}
+		else
+		{
+			// Else, display error message
+			std::cerr << "Job file not found!" << std::endl;
 		}
-		std::cout << '\n' << std::endl;
+	}
+
+	// Display memory from start to end, all memory if no range is given
+	void display (const Microcontroller * microcontroller,
+			const bool& withParam, const int& start, const int& end)
+	{
+		// Range to display
+		int first = withParam ? start : 0;
+		int last = withParam ? end : microcontroller->getMemorySize() - 1;
 
-		// Display memory content
-		for (int i = 0; i < microcontroller->getMemorySize(); i += 0x10)
+		// If range is invalid, display error message
+		if (first < 0 || last < first
+				|| last >= microcontroller->getMemorySize())
 		{
-			// Display row header
-			std::cout << std::hex << std::setw(4) << std::setfill('0')
-					  << i;
+			std::cerr << "Invalid address range" << std::endl;
+			return;
+		}
 
-			// Display memory row content
-			for (int j = 0; j < 0x10; j++)
-			{
-				// Separate display by byte
-				if (j == 0 || j == 8)
-				{
-					std::cout << ' ';
-				}
+		// Write whole dump at once
+		std::string dump = microcontroller->dumpMemory(first, last);
+		std::cout.write(dump.data(), dump.size());
+		std::cout.flush();
+	}
 
-				std::cout << ' '
-						  << std::hex << std::setw(2) << std::setfill('0')
-						  << (int) microcontroller->look(i + j);
+	// List breakpoints and watchpoints, numbered from 1
+	void listBreakpoints (const Microcontroller * microcontroller)
+	{
+		const std::vector<Microcontroller::Breakpoint>& breakpoints =
+				microcontroller->getBreakpoints();
+
+		// If there is none, display message
+		if (breakpoints.empty())
+		{
+			std::cout << "No breakpoints" << std::endl;
+			return;
+		}
+
+		// Display number, kind and locations of each one
+		std::ostringstream stream;
+		for (int i = 0; i < (int) breakpoints.size(); i++)
+		{
+			const Microcontroller::Breakpoint& breakpoint = breakpoints[i];
+			stream << std::dec << std::setfill(' ') << std::left << std::setw(4)
+				   << i + 1 << std::right;
+			if (breakpoint.kind == Microcontroller::BREAKPOINT)
+			{
+				stream << "Breakpoint  ";
+			}
+			else
+			{
+				stream << "Watch "
+					   << (breakpoint.kind & Microcontroller::WATCH_READ ? "R" : "")
+					   << (breakpoint.kind & Microcontroller::WATCH_WRITE ? "W" : "")
+					   << (breakpoint.kind == (Microcontroller::WATCH_READ
+							| Microcontroller::WATCH_WRITE) ? "    " : "     ");
+			}
+			stream << std::hex << std::setfill('0') << "0x" << std::setw(4)
+				   << breakpoint.start;
+			if (breakpoint.end != breakpoint.start)
+			{
+				stream << "-0x" << std::setw(4) << breakpoint.end;
 			}
-			std::cout << std::endl;
+			stream << '\n';
+		}
+		std::cout << stream.str() << std::flush;
+	}
+
+	// Set a breakpoint, or list breakpoints and watchpoints
+	void breakpoint (Microcontroller * microcontroller, const bool& withParam,
+			const int& location)
+	{
+		// If no location is provided, list breakpoints
+		if (!withParam)
+		{
+			listBreakpoints(microcontroller);
+		}
+		else if (!microcontroller->addBreakpoint(location, location,
+				Microcontroller::BREAKPOINT))
+		{
+			// Else, if location is invalid, display error message
+			std::cerr << "Invalid address" << std::endl;
+		}
+		else if (sessionLog)
+		{
+			sessionLog->record('b', microcontroller, 1, location);
+		}
+	}
+
+	// Set a watchpoint, or list breakpoints and watchpoints
+	void watch (Microcontroller * microcontroller, const std::string& start,
+			const std::string& end, const std::string& mode)
+	{
+		// If no range is provided, list breakpoints
+		if (!start.length())
+		{
+			listBreakpoints(microcontroller);
+			return;
+		}
+
+		// Get kind of access watched, writes by default
+		std::string modeInput = toUpper(mode);
+		int kind = modeInput == "R" ? Microcontroller::WATCH_READ
+				: modeInput == "RW" ? Microcontroller::WATCH_READ | Microcontroller::WATCH_WRITE
+				: modeInput == "W" || !modeInput.length() ? Microcontroller::WATCH_WRITE : 0;
+		if (!kind)
+		{
+			std::cerr << "Invalid mode" << std::endl;
+			return;
+		}
+
+		// Get range, a single location if end is not provided
+		int first = -1, last = -1;
+		if (isValidHex(start))
+		{
+			first = strtol(start.c_str(), NULL, 16);
+		}
+		if (!end.length())
+		{
+			last = first;
+		}
+		else if (isValidHex(end))
+		{
+			last = strtol(end.c_str(), NULL, 16);
+		}
+
+		// If range is invalid, display error message
+		if (!microcontroller->addBreakpoint(first, last, kind))
+		{
+			std::cerr << "Invalid address range" << std::endl;
+		}
+		else if (sessionLog)
+		{
+			sessionLog->record('w', microcontroller, 3, first, last, kind);
+		}
+	}
+
+	// Remove a breakpoint or watchpoint by number, or all of them
+	void removeBreakpoint (Microcontroller * microcontroller,
+			const bool& withParam, const int& number)
+	{
+		// If no number is provided, remove all
+		if (!withParam)
+		{
+			microcontroller->clearBreakpoints();
+		}
+		else if (!microcontroller->removeBreakpoint(number - 1))
+		{
+			// Else, if there is no such breakpoint, display error message
+			std::cerr << "Breakpoint not found" << std::endl;
+			return;
+		}
+
+		// Record number removed, 0 for all
+		if (sessionLog)
+		{
+			sessionLog->record('k', microcontroller, 1, withParam ? number : 0);
 		}
 	}
 
@@ -593,7 +1211,12 @@ namespace MicrocontrollerEmulation
 	void execute (Microcontroller * microcontroller)
 	{
 		// Execute and check for status
-		validateExecution(microcontroller, microcontroller->execute());
+		int signal = microcontroller->execute();
+		if (sessionLog)
+		{
+			sessionLog->record('e', microcontroller, 0, 0, 0, 0, signal);
+		}
+		validateExecution(microcontroller, signal);
 	}
 
 	// Execute from a specific location
@@ -640,8 +1263,12 @@ namespace MicrocontrollerEmulation
 				&& locationInput < microcontroller->getMemorySize())
 		{
 			// Check for execution status
-			validateExecution(microcontroller,
-					microcontroller->execute(locationInput));
+			int signal = microcontroller->execute(locationInput);
+			if (sessionLog)
+			{
+				sessionLog->record('g', microcontroller, 1, locationInput, 0, 0, signal);
+			}
+			validateExecution(microcontroller, signal);
 		}
 		else
 		{
@@ -650,33 +1277,602 @@ namespace MicrocontrollerEmulation
 		}
 	}
 
+	// Execute at most a number of instructions from current PC
+	void run (Microcontroller * microcontroller, const bool& withParam,
+			const int& count)
+	{
+		// Instruction count input
+		int countInput;
+
+		// If instruction count is provided, use it
+		if (withParam)
+		{
+			countInput = count;
+		}
+		else
+		{
+			// Else, get instruction count from user
+
+			// Prompt user for instruction count
+			std::string input;
+			std::cout << "> count? ";
+			getline(std::cin, input);
+
+			// If input string is empty or contains space(s) or of wrong type,
+			// set negative (invalid) count
+			if (!(input.length() && input.find(" ") == std::string::npos
+						&& isValidHex(input)))
+			{
+				countInput = -1;
+			}
+			else
+			{
+				// Else, get validated parameter(s)
+
+				// Create input string stream and parse value
+				std::istringstream stream(input);
+				stream >> std::hex >> std::setw(10)
+					   >> countInput;
+			}
+		}
+
+		// If instruction count is valid, start executing
+		if (countInput > 0)
+		{
+			// Check for execution status
+			unsigned long long budget = countInput;
+			int signal = microcontroller->run(budget);
+			if (sessionLog)
+			{
+				sessionLog->record('n', microcontroller, 1, countInput, 0, 0, signal);
+			}
+			validateExecution(microcontroller, signal);
+		}
+		else
+		{
+			// Else, display error message
+			std::cerr << "Invalid count" << std::endl;
+		}
+	}
+
+	// Convert a string of hexadecimal digit pairs to bytes
+	const bool parseBytes (const std::string& input, std::vector<unsigned char>& bytes)
+	{
+		bytes.clear();
+
+		// If input is empty or has an odd number of digits, return failure
+		if (!input.length() || input.length() % 2)
+		{
+			return false;
+		}
+
+		// Convert each pair of digits, return failure on invalid digit
+		for (int i = 0; i < (int) input.length(); i += 2)
+		{
+			char * end;
+			std::string pair = input.substr(i, 2);
+			long value = strtol(pair.c_str(), &end, 16);
+			if (*end || !isxdigit(pair[0]))
+			{
+				return false;
+			}
+			bytes.push_back(value);
+		}
+
+		// Else, return success
+		return true;
+	}
+
+	// Search memory for a byte pattern
+	void search (const Microcontroller * microcontroller,
+			const std::string& pattern, const std::string& mask)
+	{
+		// Pattern input
+		std::string patternInput = pattern;
+
+		// If pattern is not provided, get it from user
+		if (!patternInput.length())
+		{
+			std::cout << "> pattern? ";
+			getline(std::cin, patternInput);
+		}
+
+		// If pattern or mask is invalid, display error message
+		std::vector<unsigned char> bytes, bits;
+		if (!parseBytes(patternInput, bytes))
+		{
+			std::cerr << "Invalid pattern" << std::endl;
+			return;
+		}
+		if (mask.length() && !(parseBytes(mask, bits) && bits.size() == bytes.size()))
+		{
+			std::cerr << "Invalid mask" << std::endl;
+			return;
+		}
+
+		// Search and display locations found, 8 per line
+		std::vector<int> matches;
+		int count = microcontroller->searchMemory(bytes, bits, matches);
+		std::ostringstream stream;
+		stream << std::dec << count << (count == 1 ? " match" : " matches");
+		for (int i = 0; i < (int) matches.size(); i++)
+		{
+			stream << (i % 8 ? " " : "\n") << "0x" << std::hex
+				   << std::setw(4) << std::setfill('0') << matches[i];
+		}
+		if (count > (int) matches.size())
+		{
+			stream << "\n... " << std::dec << count - matches.size() << " more";
+		}
+		std::cout << stream.str() << std::endl;
+	}
+
+	// Execute one instruction from current PC
+	void step (Microcontroller * microcontroller)
+	{
+		// Check for execution status
+		unsigned long long budget = 1;
+		int signal = microcontroller->run(budget);
+		if (sessionLog)
+		{
+			sessionLog->record('t', microcontroller, 0, 0, 0, 0, signal);
+		}
+		validateExecution(microcontroller, signal);
+	}
+
+	// Compare memory with a saved state
+	void compare (const MicrocontrollerFactory * factory,
+			const Microcontroller * microcontroller, const std::string& filename)
+	{
+		// Filename input, saved slot of the microcontroller type by default
+		std::string filenameInput = filename.length() ? filename
+				: "save." + toLower(microcontroller->getType());
+
+		// Load saved state into a reset microcontroller of the same type and
+		// memory size
+		Microcontroller * saved = factory->createMicrocontroller(
+				microcontroller->getType());
+		saved->setFrameRate(-1);
+		saved->setMemorySize(microcontroller->getMemorySize());
+		saved->initialize();
+		int deltas;
+		int status = loadSlot(saved, filenameInput, deltas);
+
+		// If state not loaded, display error message
+		if (status == SLOT_NOT_FOUND)
+		{
+			std::cerr << "Saved state not found!" << std::endl;
+		}
+		else if (status < 0)
+		{
+			std::cerr << "Invalid snapshot" << std::endl;
+		}
+		else if (status)
+		{
+			std::cerr << "Unknown state at line " << std::dec << status
+					  << std::endl;
+		}
+		else
+		{
+			// Else, display PC and changed ranges, with their bytes if short
+			std::ostringstream stream;
+			stream << std::hex << std::setfill('0');
+			if (saved->getPC() != microcontroller->getPC())
+			{
+				stream << "PC: 0x" << std::setw(4) << saved->getPC()
+					   << " -> 0x" << std::setw(4) << microcontroller->getPC()
+					   << '\n';
+			}
+
+			std::vector<std::pair<int, int> > ranges =
+					microcontroller->compareMemory(*saved);
+			int changed = 0;
+			for (int i = 0; i < (int) ranges.size(); i++)
+			{
+				int start = ranges[i].first, end = ranges[i].second;
+				changed += end - start;
+				if (i >= 64)
+				{
+					continue;
+				}
+
+				stream << "0x" << std::setw(4) << start << "-0x"
+					   << std::setw(4) << end - 1;
+				if (end - start <= 8)
+				{
+					for (int j = start; j < end; j++)
+					{
+						stream << ' ' << std::setw(2) << (int) saved->look(j);
+					}
+					stream << " ->";
+					for (int j = start; j < end; j++)
+					{
+						stream << ' ' << std::setw(2) << (int) microcontroller->look(j);
+					}
+				}
+				stream << '\n';
+			}
+			if (ranges.size() > 64)
+			{
+				stream << "... " << std::dec << ranges.size() - 64 << " more\n";
+			}
+			stream << std::dec << changed << " bytes changed in "
+				   << ranges.size() << (ranges.size() == 1 ? " range" : " ranges");
+			std::cout << stream.str() << std::endl;
+		}
+
+		delete saved;
+	}
+
+	// Set rate of frames presented while executing
+	void video (Microcontroller * microcontroller, const bool& withParam,
+			const std::string& rate)
+	{
+		// Frame rate input
+		std::string input = rate;
+		int rateInput;
+
+		// If frame rate is not provided, get it from user
+		if (!withParam)
+		{
+			std::cout << "> fps? ";
+			getline(std::cin, input);
+		}
+
+		// If input is 'off', go headless, else if it is empty or contains
+		// space(s) or of wrong type, set negative (invalid) rate
+		if (toLower(input) == "off")
+		{
+			microcontroller->setFrameRate(-1);
+			std::cout << "Output is headless" << std::endl;
+			return;
+		}
+		else if (!(input.length() && input.find(" ") == std::string::npos
+					&& isValidHex(input)))
+		{
+			rateInput = -1;
+		}
+		else
+		{
+			// Else, get validated parameter(s)
+
+			// Create input string stream and parse value
+			std::istringstream stream(input);
+			stream >> std::hex >> std::setw(10)
+				   >> rateInput;
+		}
+
+		// If frame rate is valid, set it
+		if (rateInput >= 0)
+		{
+			microcontroller->setFrameRate(rateInput);
+			std::cout << "Frame rate set" << std::endl;
+		}
+		else
+		{
+			// Else, display error message
+			std::cerr << "Invalid frame rate" << std::endl;
+		}
+	}
+
+	// Start, stop or reset execution counters
+	void instrument (Microcontroller * microcontroller, const bool& withParam,
+			const std::string& mode)
+	{
+		// Mode input
+		std::string input = mode;
+
+		// If mode is not provided, get it from user
+		if (!withParam)
+		{
+			std::cout << "> on, off or reset? ";
+			getline(std::cin, input);
+		}
+
+		// Apply mode, or display error message if it is invalid
+		input = toLower(input);
+		if (input == "on")
+		{
+			if (microcontroller->setInstrumented(true))
+			{
+				std::cout << "Instrumentation started" << std::endl;
+			}
+			else
+			{
+				std::cerr << "Instrumentation is not compiled in" << std::endl;
+			}
+		}
+		else if (input == "off")
+		{
+			microcontroller->setInstrumented(false);
+			std::cout << "Instrumentation stopped" << std::endl;
+		}
+		else if (input == "reset")
+		{
+			microcontroller->resetStatistics();
+			std::cout << "Statistics reset" << std::endl;
+		}
+		else
+		{
+			std::cerr << "Invalid instrumentation mode" << std::endl;
+		}
+	}
+
+	// Start or stop the sampling profiler, or report its samples
+	void profile (Microcontroller * microcontroller, const bool& withParam,
+			const std::string& mode)
+	{
+		// Mode input
+		std::string input = mode;
+
+		// If mode is not provided, get it from user
+		if (!withParam)
+		{
+			std::cout << "> on, off or report? ";
+			getline(std::cin, input);
+		}
+
+		// Apply mode, or display error message if it is invalid
+		input = toLower(input);
+		if (input == "on")
+		{
+			microcontroller->startProfiler();
+			std::cout << "Profiler started" << std::endl;
+		}
+		else if (input == "off")
+		{
+			microcontroller->stopProfiler();
+			std::cout << "Profiler stopped\n"
+					  << microcontroller->profileString() << std::flush;
+		}
+		else if (input == "report")
+		{
+			std::cout << microcontroller->profileString() << std::flush;
+		}
+		else
+		{
+			std::cerr << "Invalid profiler mode" << std::endl;
+		}
+	}
+
+	// Start or stop recording executed instructions, or dump the records
+	void trace (Microcontroller * microcontroller, const bool& withParam,
+			const std::string& mode)
+	{
+		// Mode input
+		std::string input = mode;
+
+		// If mode is not provided, get it from user
+		if (!withParam)
+		{
+			std::cout << "> on, off or dump? ";
+			getline(std::cin, input);
+		}
+
+		// Apply mode, or display error message if it is invalid
+		input = toLower(input);
+		if (input == "on")
+		{
+			microcontroller->startTrace();
+			std::cout << "Trace started" << std::endl;
+		}
+		else if (input == "off")
+		{
+			microcontroller->stopTrace();
+			std::cout << "Trace stopped, " << std::dec
+					  << microcontroller->getTraceCount()
+					  << " instructions recorded" << std::endl;
+		}
+		else if (input == "dump")
+		{
+			// Dump to trace.<type>
+			std::string filename = "trace." + toLower(microcontroller->getType());
+			std::ofstream fstream(filename.c_str(),
+					std::ios::out | std::ios::trunc | std::ios::binary);
+			if (microcontroller->dumpTrace(fstream))
+			{
+				std::cout << "Trace saved to " << filename << std::endl;
+			}
+			else
+			{
+				std::cerr << "Trace not found or cannot be saved" << std::endl;
+			}
+		}
+		else
+		{
+			std::cerr << "Invalid trace mode" << std::endl;
+		}
+	}
+
+	// Record execution, or go back to an earlier instruction or to the last
+	// write of a memory location
+	void reverse (Microcontroller * microcontroller, const bool& withParam,
+			const std::string& mode, const std::string& value)
+	{
+		// Mode input
+		std::string input = mode;
+
+		// If mode is not provided, get it from user
+		if (!withParam)
+		{
+			std::cout << "> on, off, back or write? ";
+			getline(std::cin, input);
+		}
+
+		// Parse hexadecimal value if provided
+		input = toLower(input);
+		unsigned long long valueInput = 0;
+		if (value.length())
+		{
+			std::istringstream stream(value);
+			if (!(isValidHex(value) && stream >> std::hex >> std::setw(10) >> valueInput))
+			{
+				std::cerr << "Invalid value" << std::endl;
+				return;
+			}
+		}
+
+		// Apply mode, or display error message if it is invalid
+		if (input == "on")
+		{
+			// Start recording, a checkpoint every 0x10000 instructions by default
+			unsigned long long interval = value.length() ? valueInput : 1 << 16;
+			if (!interval)
+			{
+				std::cerr << "Invalid checkpoint interval" << std::endl;
+				return;
+			}
+			microcontroller->startRecording(interval);
+			if (sessionLog)
+			{
+				sessionLog->record('z', microcontroller, 2, SessionLog::REVERSE_ON, interval);
+			}
+			std::cout << "Recording started, a checkpoint every 0x" << std::hex
+					  << interval << " instructions" << std::endl;
+			return;
+		}
+		else if (input == "off")
+		{
+			microcontroller->stopRecording();
+			if (sessionLog)
+			{
+				sessionLog->record('z', microcontroller, 1, SessionLog::REVERSE_OFF);
+			}
+			std::cout << "Recording stopped" << std::endl;
+			return;
+		}
+		else if (input != "back" && input != "write")
+		{
+			std::cerr << "Invalid reverse mode" << std::endl;
+			return;
+		}
+
+		// Going back needs a recording
+		if (!microcontroller->isRecording())
+		{
+			std::cerr << "Recording not started" << std::endl;
+			return;
+		}
+
+		unsigned long long present = microcontroller->getRecordedTime();
+		if (input == "back")
+		{
+			// Go back count instructions, 1 by default
+			unsigned long long count = value.length() ? valueInput : 1;
+			if (!count || count > present - microcontroller->getOldestTime()
+					|| !microcontroller->travelTo(present - count))
+			{
+				std::cerr << "Cannot go back 0x" << std::hex << count
+						  << " instructions, 0x"
+						  << present - microcontroller->getOldestTime()
+						  << " recorded" << std::endl;
+				return;
+			}
+			if (sessionLog)
+			{
+				sessionLog->record('z', microcontroller, 2, SessionLog::REVERSE_BACK, count);
+			}
+			std::cout << "Went back 0x" << std::hex << count
+					  << " instructions. Program Counter = 0x"
+					  << microcontroller->getPC() << std::endl;
+		}
+		else
+		{
+			// Go back to the last write of a memory location
+			unsigned long long time;
+			if (!value.length() || (int) valueInput >= microcontroller->getMemorySize())
+			{
+				std::cerr << "Invalid address" << std::endl;
+				return;
+			}
+			bool found = microcontroller->findLastWrite(valueInput, time);
+			if (sessionLog)
+			{
+				sessionLog->record('z', microcontroller, 2, SessionLog::REVERSE_WRITE, valueInput);
+			}
+			if (found)
+			{
+				std::cout << "Last write of 0x" << std::hex << valueInput
+						  << " by instruction at 0x" << microcontroller->getPC()
+						  << ", 0x" << present - time << " instructions back"
+						  << std::endl;
+			}
+			else
+			{
+				std::cout << "No write of 0x" << std::hex << valueInput
+						  << " recorded" << std::endl;
+			}
+		}
+	}
+
 	// Function to display Help Menu
 	void displayMenu ()
 	{
 		std::cout << "\nThis is the Microcontroller Emulation Program.\n"
 				  << "Usage: main\n"
-				  << "       main < {command file}\n\n"
+				  << "       main < {command file}\n"
+				  << "       main [-q] [script]   Batch mode, without prompts or echo\n"
+				  << "                            (-q: errors and b, d, f, h, l, o, p, s, u, w only)\n"
+				  << "       main -r {log} ...    Record the session to a log\n"
+				  << "       main -v {log}...     Replay session logs on all cores and check them\n\n"
 				  << "List of available commands (case-insensitive):\n"
 				  << "  <               Load saved state\n"
-				  << "  >               Save current state\n"
-				  << "  c [type]        Connect to microcontroller ('Create')\n"
+				  << "  > [fmt]         Save current state\n"
+				  << "                  Format (fmt) is BINARY snapshot (default),\n"
+				  << "                  DELTA of pages written since the last snapshot\n"
+				  << "                  or TEXT. Load detects the format by itself and\n"
+				  << "                  applies the deltas chained to the snapshot.\n"
+				  << "  b [addr]        Stop before executing addr ('Breakpoint'), or\n"
+				  << "                  list breakpoints and watchpoints. Memory\n"
+				  << "                  location (addr) must be in hexadecimal format.\n"
+				  << "  c [type] [eng] [size]\n"
+				  << "                  Connect to microcontroller ('Create')\n"
 				  << "                  Microcontroller type can be entered directly or\n"
 				  << "                  prompted later. Possible types are:\n"
-				  << "                  " << MicrocontrollerFactory::TYPES[0];
+				  << "                  ";
 
-		// List all microcontroller types
-		for (int i = 1; i < MicrocontrollerFactory::numberOfTypes(); i++)
+		// List all microcontroller types registered
+		const std::vector<std::string>& types = MicrocontrollerFactory::getTypes();
+		for (size_t i = 0; i < types.size(); i++)
 		{
-			std::cout << ", " << MicrocontrollerFactory::TYPES[i];
+			std::cout << (i ? ", " : "") << types[i];
 		}
 		std::cout << ".\n"
-				  << "  d               Display all memory\n"
+				  << "                  Execution engine (eng) is optional, support\n"
+				  << "                  depends on the type. Possible engines are:\n"
+				  << "                  " << Microcontroller::ENGINES[0];
+
+		// List all execution engines
+		for (int i = 1; i < Microcontroller::numberOfEngines(); i++)
+		{
+			std::cout << ", " << Microcontroller::ENGINES[i];
+		}
+		std::cout << ".\n"
+				  << "                  Memory size (hexadecimal) is optional, from the\n"
+				  << "                  size of the type up to 0x1000000. Large memories\n"
+				  << "                  only use host memory for the pages written.\n"
+				  << "  d [start] [end] Display memory\n"
+				  << "                  Whole memory by default, or rows from start to\n"
+				  << "                  end (default end of memory), in hexadecimal.\n"
+				  << "                  Repeated zero rows are shown as '*'.\n"
 				  << "  e               Execute from current PC\n"
+				  << "  f [file]        Run a batch of jobs on all cores ('Fleet')\n"
+				  << "                  Job file can be entered directly or prompted\n"
+				  << "                  later. Each line of the file is:\n"
+				  << "                  type statefile [pc] [budget] [eng]\n"
+				  << "                  PC and budget must be in hexadecimal format.\n"
 				  << "  g [addr]        Execution from a specific location ('Go')\n"
 				  << "                  Memory location (addr) can be entered directly\n"
 				  << "                  or prompted later. Memory location (addr) must\n"
 				  << "                  be in hexadecimal format.\n"
 				  << "  h               Display Help\n"
+				  << "  i [mode]        Count executed instructions ('Instrumentation')\n"
+				  << "                  Mode can be entered directly or prompted later.\n"
+				  << "                  ON starts counting with the interpreter, OFF\n"
+				  << "                  stops it and RESET clears the counters. Status\n"
+				  << "                  shows the counters.\n"
+				  << "  k [num]         Remove breakpoint or watchpoint num as listed,\n"
+				  << "                  or all of them ('Kill')\n"
 				  << "  l [addr]        Look at memory\n"
 				  << "                  Memory location (addr) can be entered directly\n"
 				  << "                  or prompted later. Memory location (addr) must\n"
@@ -687,8 +1883,54 @@ namespace MicrocontrollerEmulation
 				  << "                  location (addr) and value (val) must be in\n"
 				  << "                  hexadecimal format. Only the right most byte\n"
 				  << "                  of the value is stored.\n"
+				  << "  n [count]       Run at most count instructions from current PC\n"
+				  << "                  Instruction count can be entered directly or\n"
+				  << "                  prompted later. Instruction count must be in\n"
+				  << "                  hexadecimal format.\n"
+				  << "  o [pat] [mask]  Search memory for a byte pattern ('Occurrences')\n"
+				  << "                  Pattern (pat) can be entered directly or\n"
+				  << "                  prompted later, as hexadecimal digit pairs,\n"
+				  << "                  e.g. 4865. The optional mask has as many pairs,\n"
+				  << "                  only its set bits are compared.\n"
+				  << "  p [mode]        Sample the PC while executing ('Profile')\n"
+				  << "                  Mode can be entered directly or prompted later.\n"
+				  << "                  ON starts a new profile on the selected engine\n"
+				  << "                  (JIT samples the start of each block), OFF\n"
+				  << "                  stops it and REPORT shows the hottest\n"
+				  << "                  addresses and loops with their instructions.\n"
 				  << "  r               Reset microcontroller\n"
-				  << "  s               Display PC and registers ('Status')\n"
+				  << "  s               Display PC and registers ('Status'), and\n"
+				  << "                  execution counters if instrumented.\n"
+				  << "  t               Execute one instruction from current PC ('sTep')\n"
+				  << "  u [file]        Compare memory and PC with a saved state ('Updates')\n"
+				  << "                  File is the saved slot of the type by default,\n"
+				  << "                  with its deltas. Changed ranges are listed.\n"
+				  << "  v [fps]         Set output frames presented per second while\n"
+				  << "                  executing ('Video'). Frame rate can be entered\n"
+				  << "                  directly or prompted later, in hexadecimal\n"
+				  << "                  format. 0 presents output after each command\n"
+				  << "                  only, 'off' never presents it (headless).\n"
+				  << "  w [start] [end] [mode]\n"
+				  << "                  Stop after an access to memory from start to\n"
+				  << "                  end ('Watchpoint'), or list breakpoints and\n"
+				  << "                  watchpoints. Locations are in hexadecimal\n"
+				  << "                  format, end defaults to start. Mode is R, W\n"
+				  << "                  (default) or RW for reads, writes or both.\n"
+				  << "                  Execution resumes from a stop with 'e'.\n"
+				  << "  x [mode]        Record executed instructions ('eXecution trace')\n"
+				  << "                  Mode can be entered directly or prompted later.\n"
+				  << "                  ON starts a new trace with the interpreter,\n"
+				  << "                  keeping the last 1M instructions, OFF stops it\n"
+				  << "                  and DUMP saves it to trace.<type> for the\n"
+				  << "                  TraceView tool.\n"
+				  << "  z [mode] [val]  Record execution to go back in time ('reverse')\n"
+				  << "                  Mode can be entered directly or prompted later.\n"
+				  << "                  ON [interval] records a checkpoint every\n"
+				  << "                  interval instructions (default 10000), OFF\n"
+				  << "                  stops it, BACK [count] goes back count\n"
+				  << "                  instructions (default 1) and WRITE addr goes\n"
+				  << "                  back to the last instruction writing addr,\n"
+				  << "                  before it executes. Values are hexadecimal.\n"
 				  << "  q               Quit the program\n" << std::endl;
 	}
 
@@ -829,6 +2071,11 @@ namespace MicrocontrollerEmulation
 			{
 				microcontroller->modify(locationInput,
 						(unsigned char) (valueInput & 0xFF));
+				if (sessionLog)
+				{
+					sessionLog->record('m', microcontroller, 2, locationInput,
+							valueInput & 0xFF);
+				}
 			}
 			else
 			{
@@ -848,6 +2095,10 @@ namespace MicrocontrollerEmulation
 	{
 		// Re-initialize microcontroller
 		microcontroller->initialize();
+		if (sessionLog)
+		{
+			sessionLog->record('r', microcontroller);
+		}
 
 		// Display informational message
 		std::cout << "Microcontroller reset" << std::endl;
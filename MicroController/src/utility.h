@@ -9,10 +9,14 @@
 #define SRC_UTILITY_H_
 
 #include <string>
+#include <vector>
 #include "Microcontroller.h"
 #include "MicrocontrollerFactory.h"
+#include "SessionLog.h"
 
 namespace MicrocontrollerEmulation {
+const int SLOT_NOT_FOUND = -2;	// Status of loadSlot when the file does not exist
+
 // Function prototypes
 const std::string getCommand();	// Get user command
 const bool isValidCommand(const std::string& command);// Check if an input is a valid command
@@ -24,21 +28,63 @@ void utilize(const std::string& commandLine,
 		Microcontroller *& microcontroller);// Utilize command and call corresponding function
 void validateExecution(const Microcontroller * microcontroller,
 		const int& singal);	// Validate execution
-void save(const Microcontroller * microcontroller);	// Save microcontroller state
+void save(Microcontroller * microcontroller,
+		const std::string& format = "");	// Save microcontroller state
 void load(Microcontroller * microcontroller);	// Load microcontroller state
+const int loadSlot(Microcontroller * microcontroller,
+		const std::string& filename, int& deltas);	// Load state and chained deltas from a file, return loadState status or SLOT_NOT_FOUND
 Microcontroller * connect(const MicrocontrollerFactory * factory,
-		const std::string& type = "");	// Connect (create) microcontroller
-void display(const Microcontroller * microcontroller);// Display all memory of specified microcontroller
+		const std::string& type = "",
+		const std::string& engine = "",
+		const std::string& size = "");	// Connect (create) microcontroller
+void display(const Microcontroller * microcontroller,
+		const bool& withParam = false, const int& start = 0,
+		const int& end = 0);	// Display memory of specified microcontroller
+void fleet(const MicrocontrollerFactory * factory,
+		const std::string& filename = "");	// Run a batch of jobs on all cores
 void execute(Microcontroller * microcontroller);	// Execute from current PC
 void go(Microcontroller * microcontroller, const bool& withParam = false,
 		const int& location = 0);	// Execute from a specific location
 void displayMenu();	// Display Help menu
+void instrument(Microcontroller * microcontroller,
+		const bool& withParam = false,
+		const std::string& mode = "");	// Start, stop or reset execution counters
 void look(const Microcontroller * microcontroller,
 		const bool& withParam = false, const int& location = 0);// Look at a specific memory location
 void modify(Microcontroller * microcontroller, const bool& withParam = false,
 		const int& location = 0, const int& value = 0);	// Modify a specific memory location
+void run(Microcontroller * microcontroller, const bool& withParam = false,
+		const int& count = 0);	// Execute at most a number of instructions
+void profile(Microcontroller * microcontroller, const bool& withParam = false,
+		const std::string& mode = "");	// Start or stop the sampling profiler, or report its samples
 void reset(Microcontroller * microcontroller);	// Reset microcontroller
 void status(const Microcontroller * microcontroller);// Display PC and registers
+void step(Microcontroller * microcontroller);	// Execute one instruction
+void listBreakpoints(const Microcontroller * microcontroller);	// List breakpoints and watchpoints
+void breakpoint(Microcontroller * microcontroller, const bool& withParam = false,
+		const int& location = 0);	// Set a breakpoint, or list breakpoints and watchpoints
+void watch(Microcontroller * microcontroller, const std::string& start = "",
+		const std::string& end = "",
+		const std::string& mode = "");	// Set a watchpoint, or list breakpoints and watchpoints
+void removeBreakpoint(Microcontroller * microcontroller,
+		const bool& withParam = false, const int& number = 0);	// Remove a breakpoint or watchpoint, or all of them
+const bool parseBytes(const std::string& input,
+		std::vector<unsigned char>& bytes);	// Convert a string of hexadecimal digit pairs to bytes
+void search(const Microcontroller * microcontroller,
+		const std::string& pattern = "",
+		const std::string& mask = "");	// Search memory for a byte pattern
+void compare(const MicrocontrollerFactory * factory,
+		const Microcontroller * microcontroller,
+		const std::string& filename = "");	// Compare memory with a saved state
+void video(Microcontroller * microcontroller, const bool& withParam = false,
+		const std::string& rate = "");	// Set rate of frames presented while executing
+void trace(Microcontroller * microcontroller, const bool& withParam = false,
+		const std::string& mode = "");	// Start or stop recording executed instructions, or dump the records
+void reverse(Microcontroller * microcontroller, const bool& withParam = false,
+		const std::string& mode = "",
+		const std::string& value = "");	// Record execution, or go back to an earlier instruction or to the last write of a memory location
+void setSessionLog(SessionLog * log);	// Record commands changing the microcontroller to a session log, NULL to stop
+SessionLog * getSessionLog();	// Get session log commands are recorded to, NULL if none
 }
 
 #endif /* SRC_UTILITY_H_ */
@@ -0,0 +1,467 @@
+/*
+ * benchmark.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include "../src/Microcontroller.h"
+#include "../src/MicrocontrollerFactory.h"
+#include "../src/utility.h"
+
+/* BENCHMARK SUITE:
+   - Every workload is a guest program loaded at an entry PC and run with
+     run() for a fixed instruction budget, once per engine its type
+     supports. Programs loop forever, so each run executes the whole budget
+     unless the program stops.
+   - Every operation (initialize, state and snapshot save/load, display,
+     clone) is timed on a chip whose memory is filled with a dense pattern.
+   - With -p, workloads run with the profiler sampling the PC, as after
+     'p on', to measure its overhead on each engine.
+   - Each measurement is repeated after a warm-up run, and reported as
+     mean and standard deviation of the time per instruction/operation.
+*/
+
+using namespace MicrocontrollerEmulation;
+
+namespace
+{
+	// Guest program run by the benchmark
+	struct Workload
+	{
+		const char * type;	// Microcontroller type
+		const char * name;	// Workload name
+		int location;	// Entry PC and load address
+		std::vector<unsigned char> program;	// Program bytes
+	};
+
+	// Result of repeated measurements
+	struct Result
+	{
+		double mean, deviation;	// Mean and standard deviation of ns per unit
+		unsigned long long units;	// Instructions or operations per repeat
+	};
+
+	// Benchmark settings
+	struct Settings
+	{
+		bool csv;	// Write CSV instead of a table
+		bool profile;	// Run workloads with the profiler sampling the PC
+		int repeats;	// Measured repeats of each benchmark
+		unsigned long long budget;	// Instructions per workload repeat
+		std::string filter;	// Only run benchmarks whose name contains this
+	};
+
+	// Get seconds elapsed on a monotonic clock
+	double now ()
+	{
+		struct timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return time.tv_sec + time.tv_nsec * 1e-9;
+	}
+
+	// Append a 16-bit big-endian address to a program
+	void address (std::vector<unsigned char>& program, const int& location)
+	{
+		program.push_back(location >> 8);
+		program.push_back(location & 0xFF);
+	}
+
+	// Build the library of guest programs
+	std::vector<Workload> workloads ()
+	{
+		std::vector<Workload> list;
+		Workload workload;
+
+		// R500: tight counting loop, add 1 to memory and branch back
+		workload.type = "R500";
+		workload.name = "count";
+		workload.location = 0;
+		workload.program.clear();
+		workload.program.push_back(0x0A);
+		workload.program.push_back(0x01);
+		address(workload.program, 0x3FF);
+		workload.program.push_back(0x17);
+		workload.program.push_back(0xFC);
+		list.push_back(workload);
+
+		// R500: memory sweep, add to 64 consecutive locations then go back
+		workload.name = "sweep";
+		workload.program.clear();
+		for (int i = 0; i < 64; i++)
+		{
+			workload.program.push_back(0x0A);
+			workload.program.push_back(i + 1);
+			address(workload.program, 0x200 + i);
+		}
+		workload.program.push_back(0x16);
+		address(workload.program, 0);
+		list.push_back(workload);
+
+		// R500: branch-heavy code, a chain of taken branches and gotos
+		workload.name = "branch";
+		workload.program.clear();
+		for (int i = 0; i < 64; i++)
+		{
+			workload.program.push_back(0x17);
+			workload.program.push_back(0x02);
+		}
+		workload.program.push_back(0x16);
+		address(workload.program, 0);
+		list.push_back(workload);
+
+		// R500: self-modifying loop, changing the operand of the next add
+		workload.name = "selfmod";
+		workload.program.clear();
+		workload.program.push_back(0x0A);
+		workload.program.push_back(0x01);
+		address(workload.program, 0x005);
+		workload.program.push_back(0x0A);
+		workload.program.push_back(0x00);
+		address(workload.program, 0x300);
+		workload.program.push_back(0x17);
+		workload.program.push_back(0xF8);
+		list.push_back(workload);
+
+		// PIC32F42: tight counting loop, add 1 to W and go back
+		workload.type = "PIC32F42";
+		workload.name = "count";
+		workload.location = 0x400;
+		workload.program.clear();
+		workload.program.push_back(0x5A);
+		workload.program.push_back(0x01);
+		workload.program.push_back(0x6E);
+		address(workload.program, 0x400);
+		list.push_back(workload);
+
+		// PIC32F42: screen fill, store W over 160 screen cells per frame
+		workload.name = "screen";
+		workload.location = 0x3E8;
+		workload.program.clear();
+		workload.program.push_back(0x5A);
+		workload.program.push_back(0x01);
+		for (int i = 0; i < 160; i++)
+		{
+			workload.program.push_back(0x51);
+			address(workload.program, i * 6 + 1);
+		}
+		workload.program.push_back(0x6E);
+		address(workload.program, 0x3E8);
+		list.push_back(workload);
+
+		// PIC32F42: branch-heavy code, a chain of gotos
+		workload.name = "branch";
+		workload.location = 0x400;
+		workload.program.clear();
+		for (int i = 0; i < 64; i++)
+		{
+			workload.program.push_back(0x6E);
+			address(workload.program, 0x400 + (i + 1) * 3);
+		}
+		workload.program.push_back(0x6E);
+		address(workload.program, 0x400);
+		list.push_back(workload);
+
+		return list;
+	}
+
+	// Compute mean and standard deviation of samples
+	Result summarize (const std::vector<double>& samples, const unsigned long long& units)
+	{
+		Result result = {0, 0, units};
+		for (int i = 0; i < (int) samples.size(); i++)
+		{
+			result.mean += samples[i];
+		}
+		result.mean /= samples.size();
+		for (int i = 0; i < (int) samples.size(); i++)
+		{
+			result.deviation += (samples[i] - result.mean) * (samples[i] - result.mean);
+		}
+		result.deviation = std::sqrt(result.deviation / samples.size());
+
+		return result;
+	}
+
+	// Create a headless microcontroller, reset
+	Microcontroller * create (const MicrocontrollerFactory& factory, const std::string& type)
+	{
+		Microcontroller * microcontroller = factory.createMicrocontroller(type);
+		microcontroller->initialize();
+		microcontroller->setFrameRate(-1);
+		return microcontroller;
+	}
+
+	// Run a workload on an engine, return ns per instruction
+	Result runWorkload (const MicrocontrollerFactory& factory,
+			const Workload& workload, const int& engine, const Settings& settings)
+	{
+		// Load program
+		Microcontroller * microcontroller = create(factory, workload.type);
+		microcontroller->setEngine(engine);
+		for (int i = 0; i < (int) workload.program.size(); i++)
+		{
+			microcontroller->modify(workload.location + i, workload.program[i]);
+		}
+
+		// Sample the PC while running if requested
+		if (settings.profile)
+		{
+			microcontroller->startProfiler();
+		}
+
+		// Warm up caches and translated code, then run the repeats
+		std::vector<double> samples;
+		unsigned long long executed = 0;
+		for (int i = 0; i <= settings.repeats; i++)
+		{
+			unsigned long long budget = i ? settings.budget : settings.budget / 16 + 1;
+			unsigned long long start = budget;
+			double time = now();
+			microcontroller->runWithDeadline(budget, 0, workload.location);
+			time = now() - time;
+
+			// Only measured repeats count
+			if (i)
+			{
+				executed = start - budget;
+				samples.push_back(executed ? time * 1e9 / executed : 0);
+			}
+		}
+
+		microcontroller->stopProfiler();
+		delete microcontroller;
+		return summarize(samples, executed);
+	}
+
+	// Time one operation on a dense microcontroller, return ns per operation
+	template <class Operation>
+	Result timeOperation (const Settings& settings, Operation operation)
+	{
+		// Size repeats to about 20 ms from a warm-up call
+		double time = now();
+		operation();
+		time = now() - time;
+		unsigned long long count = std::max(1.0, std::min(1e6, 0.02 / std::max(time, 1e-9)));
+
+		std::vector<double> samples;
+		for (int i = 0; i < settings.repeats; i++)
+		{
+			time = now();
+			for (unsigned long long j = 0; j < count; j++)
+			{
+				operation();
+			}
+			samples.push_back((now() - time) * 1e9 / count);
+		}
+
+		return summarize(samples, count);
+	}
+
+	// Write a result as a table row or CSV line
+	void report (const Settings& settings, const std::string& kind,
+			const std::string& type, const std::string& name,
+			const std::string& engine, const Result& result)
+	{
+		double rate = result.mean > 0 ? 1e9 / result.mean : 0;
+		if (settings.csv)
+		{
+			std::cout << kind << ',' << type << ',' << name << ',' << engine << ','
+					  << result.units << ',' << result.mean << ','
+					  << result.deviation << ',' << rate << '\n';
+		}
+		else
+		{
+			std::cout << std::left << std::setw(10) << type << std::setw(13) << name
+					  << std::setw(13) << engine << std::right << std::setw(14)
+					  << std::setprecision(4) << rate
+					  << (kind == "workload" ? " instr/s" : "    ops/s")
+					  << std::setw(12) << result.mean << " ns +- "
+					  << std::setw(5) << std::setprecision(2)
+					  << (result.mean > 0 ? 100 * result.deviation / result.mean : 0)
+					  << " %\n";
+		}
+		std::cout.flush();
+	}
+
+	// Check if a benchmark passes the filter
+	const bool selected (const Settings& settings, const std::string& type,
+			const std::string& name, const std::string& engine)
+	{
+		return (type + ' ' + name + ' ' + engine).find(settings.filter) != std::string::npos;
+	}
+}
+
+int main (int argc, char * argv[])
+{
+	// Default settings
+	Settings settings = {false, false, 5, 1 << 24, ""};
+
+	// Parse arguments
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-csv")
+		{
+			settings.csv = true;
+		}
+		else if (argument == "-p")
+		{
+			settings.profile = true;
+		}
+		else if (argument == "-r" && i + 1 < argc)
+		{
+			settings.repeats = std::max(atoi(argv[++i]), 1);
+		}
+		else if (argument == "-n" && i + 1 < argc)
+		{
+			settings.budget = std::max(strtoull(argv[++i], NULL, 10), 1ULL);
+		}
+		else if (argument[0] != '-')
+		{
+			settings.filter = toUpper(argument);
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0]
+					  << " [-csv] [-p] [-r repeats] [-n instructions] [filter]\n"
+					  << "Filter matches 'TYPE NAME ENGINE', e.g. R500, SWEEP or JIT."
+					  << std::endl;
+			return 1;
+		}
+	}
+
+	MicrocontrollerFactory factory;
+
+	// Write header
+	if (settings.csv)
+	{
+		std::cout << "kind,type,name,engine,units,mean_ns,stddev_ns,per_second\n";
+	}
+	else
+	{
+		std::cout << std::left << std::setw(10) << "TYPE" << std::setw(13) << "NAME"
+				  << std::setw(13) << "ENGINE" << std::right << std::setw(22) << "RATE"
+				  << std::setw(15) << "MEAN" << std::setw(11) << "STDDEV" << '\n';
+	}
+
+	// Run every workload on every engine its type supports
+	std::vector<Workload> list = workloads();
+	for (int i = 0; i < (int) list.size(); i++)
+	{
+		Microcontroller * probe = create(factory, list[i].type);
+		for (int engine = 0; engine < Microcontroller::numberOfEngines(); engine++)
+		{
+			std::string name = toUpper(list[i].name);
+			if (probe->supportsEngine(engine)
+					&& selected(settings, list[i].type, name, Microcontroller::ENGINES[engine]))
+			{
+				report(settings, "workload", list[i].type, name,
+						Microcontroller::ENGINES[engine],
+						runWorkload(factory, list[i], engine, settings));
+			}
+		}
+		delete probe;
+	}
+
+	// Time operations other than execution on every type
+	for (int i = 0; i < MicrocontrollerFactory::numberOfTypes(); i++)
+	{
+		const std::string& type = MicrocontrollerFactory::getTypes()[i];
+		Microcontroller * microcontroller = factory.createMicrocontroller(type);
+		if (!microcontroller)
+		{
+			continue;
+		}
+		microcontroller->initialize();
+		microcontroller->setFrameRate(-1);
+
+		// Fill memory with a dense pattern
+		for (int j = 0; j < microcontroller->getMemorySize(); j++)
+		{
+			microcontroller->modify(j, j * 7 + 1);
+		}
+		std::string state = microcontroller->getState();
+		std::ostringstream snapshot;
+		microcontroller->getSnapshot(snapshot);
+		std::string image = snapshot.str();
+
+		// Discard screen output while timing display
+		std::ostringstream sink;
+		std::streambuf * console = std::cout.rdbuf();
+
+		const char * names[] = {"INITIALIZE", "GETSTATE", "SETSTATE", "GETSNAPSHOT",
+			"SETSNAPSHOT", "DISPLAY", "CLONE"};
+		for (int j = 0; j < (int) (sizeof(names) / sizeof(names[0])); j++)
+		{
+			if (!selected(settings, type, names[j], "-"))
+			{
+				continue;
+			}
+
+			// Time the operation on its own copy, so operations do not interfere
+			Microcontroller * copy = factory.cloneMicrocontroller(microcontroller);
+			copy->setFrameRate(-1);
+			Result result;
+			switch (j)
+			{
+				case 0:
+					result = timeOperation(settings, [&] { copy->initialize(); });
+					break;
+				case 1:
+					result = timeOperation(settings, [&] { copy->getState(); });
+					break;
+				case 2:
+					result = timeOperation(settings, [&] {
+						std::istringstream stream(state);
+						copy->setState(stream);
+					});
+					break;
+				case 3:
+					result = timeOperation(settings, [&] {
+						std::ostringstream stream;
+						copy->getSnapshot(stream);
+					});
+					break;
+				case 4:
+					result = timeOperation(settings, [&] {
+						std::istringstream stream(image);
+						copy->setSnapshot(stream);
+					});
+					break;
+				case 5:
+					std::cout.rdbuf(sink.rdbuf());
+					result = timeOperation(settings, [&] {
+						display(copy);
+						sink.str("");
+					});
+					std::cout.rdbuf(console);
+					std::cout << std::dec << std::setfill(' ');
+					break;
+				case 6:
+					result = timeOperation(settings, [&] {
+						delete factory.cloneMicrocontroller(microcontroller);
+					});
+					break;
+			}
+			delete copy;
+
+			report(settings, "operation", type, names[j], "-", result);
+		}
+
+		delete microcontroller;
+	}
+
+	return 0;
+}
+
+
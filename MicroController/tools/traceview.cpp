@@ -0,0 +1,133 @@
+/*
+ * traceview.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: huy
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "../src/Microcontroller.h"
+#include "../src/MicrocontrollerFactory.h"
+#include "../src/Tracer.h"
+
+/* TRACE VIEWER:
+   - Reads a trace file dumped by the 'x dump' command and prints one line
+     per record, from the oldest kept to the newest: instruction number,
+     disassembly, register W after the instruction, memory written and the
+     signal raised if any.
+   - Records are disassembled by a microcontroller of the recorded type,
+     whose memory is patched with the recorded opcode and operands, so the
+     output matches the instruction as it was executed.
+*/
+
+using namespace MicrocontrollerEmulation;
+
+int main (int argc, char * argv[])
+{
+	// Default settings: show all records at any PC
+	std::string filename;
+	unsigned long long last = 0;
+	int location = -1;
+
+	// Parse arguments
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "-n" && i + 1 < argc)
+		{
+			last = strtoull(argv[++i], NULL, 10);
+		}
+		else if (argument == "-pc" && i + 1 < argc)
+		{
+			location = (int) strtol(argv[++i], NULL, 16);
+		}
+		else if (argument[0] != '-' && filename.empty())
+		{
+			filename = argument;
+		}
+		else
+		{
+			filename.clear();
+			break;
+		}
+	}
+	if (filename.empty())
+	{
+		std::cerr << "Usage: " << argv[0] << " [-n last] [-pc addr] tracefile\n"
+				  << "Shows the last records only, or records at a PC (hexadecimal)."
+				  << std::endl;
+		return 1;
+	}
+
+	// Load trace
+	std::ifstream fstream(filename.c_str(), std::ios::in | std::ios::binary);
+	TraceHeader header;
+	std::vector<TraceRecord> records;
+	if (!Tracer::load(fstream, header, records))
+	{
+		std::cerr << "Invalid trace file: " << filename << std::endl;
+		return 1;
+	}
+
+	// Create microcontroller of the recorded type to disassemble records
+	MicrocontrollerFactory factory;
+	Microcontroller * microcontroller = factory.createMicrocontroller(header.type);
+	if (!microcontroller)
+	{
+		std::cerr << "Unknown microcontroller type: " << header.type << std::endl;
+		return 1;
+	}
+	microcontroller->initialize();
+	microcontroller->setFrameRate(-1);
+
+	// Write summary
+	std::cout << header.type << " trace: " << header.count << " instructions recorded, "
+			  << records.size() << " kept\n";
+
+	// Write records, numbered from the first instruction recorded
+	unsigned long long first = header.count - records.size();
+	size_t start = last && last < records.size() ? records.size() - last : 0;
+	for (size_t i = start; i < records.size(); i++)
+	{
+		const TraceRecord& record = records[i];
+		if (location != -1 && record.pc != location)
+		{
+			continue;
+		}
+
+		// Patch instruction into memory and disassemble it
+		microcontroller->modify(record.pc, record.opcode);
+		for (int j = 0; j < 3; j++)
+		{
+			microcontroller->modify(record.pc + j + 1, record.operands[j]);
+		}
+		std::string instruction = microcontroller->disassemble(record.pc);
+
+		std::cout << std::dec << std::setfill(' ') << std::setw(12) << first + i << "  "
+				  << std::left << std::setw(28) << instruction << std::right
+				  << std::hex << std::setfill('0');
+		if (header.registerCount)
+		{
+			std::cout << "  W=0x" << std::setw(2) << (int) record.registerW;
+		}
+		if (record.address != -1)
+		{
+			std::cout << "  [0x" << std::setw(3) << record.address << "]=0x"
+					  << std::setw(2) << (int) record.value;
+		}
+		if (record.signal != Microcontroller::SUCCESS
+				&& record.signal <= Microcontroller::BUDGET_EXHAUSTED)
+		{
+			std::cout << "  " << Microcontroller::SIGNALS[record.signal];
+		}
+		std::cout << '\n';
+	}
+
+	delete microcontroller;
+	return 0;
+}